@@ -0,0 +1,238 @@
+# pragma once
+
+#include <array>
+#include <vector>
+#include <memory>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+
+#include <playback.hpp>
+#include <filterbank.hpp>
+
+constexpr float REFERENCE = 40.0f;      // what's considered loud (band level of a 1024 point FFT, other sizes are scaled to it)
+constexpr float REFERENCE_LUFS = -14.0f; // loudness of a typical modern master (BS.1770, stereo file), the one REFERENCE was tuned on
+
+// compile time math for the FFT tables (std::sin/cos aren't constexpr in C++17)
+namespace dsp {
+
+constexpr double PI = 3.14159265358979323846;
+
+constexpr double sin(double x) {
+    while (x > PI) x -= 2 * PI;                                             // reduce to [-pi, pi]
+    while (x < -PI) x += 2 * PI;
+    if (x > PI / 2) x = PI - x;                                             // then to [-pi/2, pi/2] where the series converges fast
+    if (x < -PI / 2) x = -PI - x;
+
+    double term = x, sum = x;
+    for (int n = 1; n < 12; n++) {
+        term *= -x * x / ((2 * n) * (2 * n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double cos(double x) { return dsp::sin(x + PI / 2); }
+
+// twiddles, bit reversal permutation and Hann window for an N point radix-2 FFT, all evaluated by the compiler
+template <size_t N>
+struct FFTTables {
+    std::array<float, N / 2> twiddleRe{}, twiddleIm{};
+    std::array<uint16_t, N> bitReversed{};
+    std::array<float, N> window{};
+
+    constexpr FFTTables() {
+        for (size_t k = 0; k < N / 2; k++) {
+            twiddleRe[k] = (float)dsp::cos(2 * PI * k / N);
+            twiddleIm[k] = (float)-dsp::sin(2 * PI * k / N);
+        }
+
+        size_t bits = 0;
+        while ((size_t(1) << bits) < N) bits++;
+        for (size_t i = 0; i < N; i++) {
+            size_t reversed = 0;
+            for (size_t b = 0; b < bits; b++) if (i & (size_t(1) << b)) reversed |= size_t(1) << (bits - 1 - b);
+            bitReversed[i] = (uint16_t)reversed;
+        }
+
+        // Hann, x2 to undo its 0.5 coherent gain so magnitudes stay comparable to REFERENCE
+        for (size_t i = 0; i < N; i++) window[i] = (float)(1.0 - dsp::cos(2 * PI * i / (N - 1)));
+    }
+};
+
+}
+
+// runtime facing side of the analyzers, one virtual call per frame picks the FFT size chosen on the command line
+class SpectrumAnalyzer {
+protected:
+    float reference = REFERENCE;
+
+public:
+    virtual ~SpectrumAnalyzer() = default;
+    virtual size_t size() const = 0;
+
+    // per track bar scaling: a track louder than REFERENCE_LUFS needs a higher reference to look the same
+    void setLoudness(float integratedLufs) { reference = REFERENCE * std::pow(10.0f, (integratedLufs - REFERENCE_LUFS) / 20.0f); }
+    void resetLoudness()                   { reference = REFERENCE; }        // track not analysed yet
+
+    // how loud each of 'bands' frequency bands is right now: 0 = silent, 1 = full bar (louder is allowed, bars clamp)
+    // mode picks how FFT bins are grouped into bands, MEL/CONSTANT_Q need the real sample rate to place them
+    // the result lives in the analyzer and is overwritten by the next call
+    virtual const std::vector<float>& levels(const Playback& playbackInfo, int bands, Spectrum mode, int sampleRate) = 0;
+
+    static int halfBars(int maxBars) { return (maxBars & 1) ? (maxBars / 2) + 1 : maxBars / 2; }
+
+    // returns mirrored maxBars (calculates fft for maxBars / 2) then mirrors it
+    std::vector<int> bars(const Playback& playbackInfo, int maxBars, int maxHeight, Spectrum mode, int sampleRate) {
+        return toBars(levels(playbackInfo, halfBars(maxBars), mode, sampleRate), maxBars, maxHeight);
+    }
+
+    // levels -> bar heights mirrored around the centre, levels at another resolution (the daemon's stream) are resampled
+    static std::vector<int> toBars(const std::vector<float>& levels, int maxBars, int maxHeight) {
+        int half_size = halfBars(maxBars);
+        int n = (int)levels.size();
+        int odd = maxBars & 1;                                              // odd bar count: the centre bar isn't mirrored
+        std::vector<int> fullBars(maxBars, 0);                              // the only allocation, it's handed to the compositor
+
+        for (int i = 0; i < half_size && n > 0; ++i) {
+            // average of the source bands under this bar (nearest one when there are fewer bands than bars)
+            int begin = i * n / half_size;
+            int end = std::max(begin + 1, (i + 1) * n / half_size);
+            float intensity = 0;
+            for (int j = begin; j < end; j++) intensity += levels[j];
+            intensity /= (end - begin);
+
+            // Scale to maxHeight
+            // This ensures 'intensity' acts as a percentage (0.0 to 1.0) of your height
+            int h = (int)(intensity * maxHeight) + 1; // we scaled everything by +1
+
+            h = std::clamp(h, 0, maxHeight);
+
+            fullBars[half_size - odd + i] = h;                              // right half, low to high
+            if (i >= odd) fullBars[half_size - 1 - i] = h;                  // its mirror on the left
+        }
+        return fullBars;
+    }
+};
+
+// everything per frame is sized by N at compile time: stack buffers, constexpr tables, fixed trip counts the compiler can unroll/vectorize
+template <size_t N>
+class Analyzer final : public SpectrumAnalyzer {
+    static_assert(N >= 16 && (N & (N - 1)) == 0, "FFT size must be a power of two");
+    static_assert(N <= 65536, "bit reversal table is 16 bit");
+
+    static constexpr dsp::FFTTables<N> tables{};
+
+    // both depend on the bar count (window width) only, sized once per count and reused every frame after that:
+    // the LINEAR layout (no pow() per bar per frame) and the band levels levels() fills in place
+    std::vector<std::pair<int, int>> linearLayout;
+    std::vector<float> bandLevels;
+
+    void resize(int bands) {
+        if ((int)bandLevels.size() == bands) return;
+        bandLevels.assign(bands, 0.0f);
+
+        constexpr int numBins = N / 2;
+        linearLayout.clear();
+        linearLayout.reserve(bands);
+        for (int i = 0; i < bands; ++i) {
+            // 1. Logarithmic Binning (Frequency Spacing)
+            float startRel = (float)i / bands;
+            float endRel = (float)(i + 1) / bands;
+
+            int startBin = (int)(pow(startRel, 1.5f) * numBins);
+            int endBin = (int)(pow(endRel, 1.5f) * numBins);
+            if (endBin <= startBin) endBin = startBin + 1;
+
+            linearLayout.emplace_back(std::min(startBin, numBins - 1), std::min(endBin, numBins));
+        }
+    }
+
+    static void fft(std::array<float, N>& re, std::array<float, N>& im) { // in place, input already in bit reversed order
+        for (size_t len = 2; len <= N; len <<= 1) {
+            const size_t half = len / 2, step = N / len;
+            for (size_t i = 0; i < N; i += len) {
+                for (size_t j = 0; j < half; j++) {
+                    float wr = tables.twiddleRe[j * step], wi = tables.twiddleIm[j * step];
+                    size_t a = i + j, b = a + half;
+
+                    float tr = re[b] * wr - im[b] * wi;
+                    float ti = re[b] * wi + im[b] * wr;
+                    re[b] = re[a] - tr; im[b] = im[a] - ti;
+                    re[a] += tr;        im[a] += ti;
+                }
+            }
+        }
+    }
+
+public:
+    size_t size() const override { return N; }
+
+    const std::vector<float>& levels(const Playback& playbackInfo, int half_size, Spectrum mode, int sampleRate) override {
+        std::array<float, N> re{}, im{};                                    // window to transform (zero padded past the end of the track)
+
+        size_t currPos = playbackInfo.position();
+        size_t total = playbackInfo.samples->size();
+        for (size_t i = 0; i < N && currPos + i < total; i++) {
+            re[tables.bitReversed[i]] = (*playbackInfo.samples)[currPos + i] * tables.window[i];
+        }
+
+        fft(re, im);
+
+        // Calculate Magnitudes
+        // The result is symmetrical, so we only need the first half (0 to nfft/2)
+        // An unnormalised FFT's peaks grow with N: scaled to what a 1024 point one gives, the size REFERENCE was tuned on
+        constexpr float scale = 1024.0f / N;
+        std::array<float, N / 2> power;
+        for (size_t i = 0; i < N / 2; ++i) {
+            // Pythagorean theorem to get the "loudness" of this frequency (squared, bands average power)
+            power[i] = scale * scale * (re[i] * re[i] + im[i] * im[i]);
+        }
+
+        // Now we can convert the bins to bands
+        resize(half_size);
+        std::vector<float>& bands = bandLevels; // mean power per band
+
+        if (mode == Spectrum::LINEAR) {
+            for (int i = 0; i < half_size; ++i) {
+                const auto& [first, last] = linearLayout[i];
+                float sum = 0;
+                for (int j = first; j < last; ++j) sum += power[j];
+                bands[i] = sum / (last - first);
+            }
+        } else {
+            // precomputed sparse filterbank (rows already normalised to averages)
+            filterbank::get(mode, sampleRate, (int)N, half_size).apply(power.data(), bands.data());
+        }
+
+        for (int i = 0; i < half_size; ++i) {
+            // a band spans N / 1024 times the bins it spans at 1024, averaging power over them (not magnitude) keeps
+            // tones and noise at the same height whatever the size
+            float avg = std::sqrt(bands[i] * N / 1024.0f);
+
+            float intensity = 0;
+            if (avg > 0) {
+                // 1. Normalize: Get a ratio between 0.0 and 1.0
+                float ratio = avg / reference;
+
+                // 2. Log Scale: This squashes the range so it's not "all or nothing"
+                // Use log2 or a smaller multiplier than 20 to keep it chill
+                intensity = 20 * log10(1.0f + ratio);
+            }
+            bands[i] = intensity;
+        }
+        return bands;
+    }
+};
+
+// the supported sizes, each instantiated here so --fft-size only chooses between ready made pipelines
+inline std::unique_ptr<SpectrumAnalyzer> makeAnalyzer(size_t fftSize) {
+    switch (fftSize) {
+        case 512:  return std::make_unique<Analyzer<512>>();
+        case 1024: return std::make_unique<Analyzer<1024>>();
+        case 2048: return std::make_unique<Analyzer<2048>>();
+        case 4096: return std::make_unique<Analyzer<4096>>();
+        default:   throw std::invalid_argument("Unsupported FFT size: " + std::to_string(fftSize) + " (use 512, 1024, 2048 or 4096)");
+    }
+}
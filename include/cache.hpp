@@ -0,0 +1,32 @@
+# pragma once
+
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <cstdint>
+
+namespace fs = std::filesystem;
+
+// Per-track analysis results live next to the music in a hidden ".asciiamp" folder
+// e.g. ../music/song.mp3 -> ../music/.asciiamp/song.mp3.wave
+namespace cache {
+
+inline fs::path pathFor(const fs::path& track, const std::string& extension) {
+    fs::path dir = track.parent_path() / ".asciiamp";
+
+    std::error_code ec; // read-only library: caching just doesn't happen, not an error
+    fs::create_directories(dir, ec);
+
+    return dir / (track.filename().string() + extension);
+}
+
+// changes whenever the file is replaced or re-tagged (size + modification time), so stale entries are ignored
+inline uint64_t keyFor(const fs::path& track) {
+    std::error_code ec;
+    uint64_t size = fs::file_size(track, ec);
+    uint64_t time = (uint64_t)fs::last_write_time(track, ec).time_since_epoch().count();
+
+    return (size * 0x9E3779B97F4A7C15ull) ^ time;
+}
+
+}
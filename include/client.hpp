@@ -0,0 +1,127 @@
+# pragma once
+
+#ifndef _WIN32
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <chrono>
+
+#include <echo.hpp>
+
+#include <music.hpp>
+#include <playback.hpp>
+#include <analyzer.hpp>
+#include <waveform.hpp>
+#include <options.hpp>
+#include <utils.hpp>
+#include <ipc.hpp>
+
+// --attach: the terminal UI of main, fed by a daemon instead of a local decoder. Nothing here touches audio, so a slow
+// terminal only ever delays this process. 'q' detaches (the music keeps playing), 'x' stops the daemon
+int runClient(const Options& opts) {
+    namespace tv = echo;
+    namespace Viz = echo::Visualizer::Plots;
+
+    ipc::Connection engine(opts.socketPath); // fails before the screen is touched when no daemon runs
+
+    tv::clear_screen();
+    Compositor compositor;
+    Compositor::Queue& ui = compositor.queue();             // main loop: cover, title, visualizer
+    Compositor::Queue& progressUi = compositor.queue();     // runTimestamp thread
+    compositor.start();
+
+    tv::Window fft(IMAGE_W + 1, 1, FULL_WINDOW_WIDTH - IMAGE_W - 1, IMAGE_H, "Visualizer");
+    tv::Window title(1, IMAGE_H + 1, FULL_WINDOW_WIDTH - 1, TITLE_H, "Now Playing");
+    tv::Window playback(1, IMAGE_H + TITLE_H + 1, FULL_WINDOW_WIDTH - 1, PLAYBACK_H, "Playback");
+
+    int barWidth = 7;
+    int maxBars = Viz::getMaxBars(fft, barWidth);
+    int playback_width = playback.get_w() * (0.7f);
+    int starting_col   = playback.get_w() * (0.15f);
+    int bar_width      = playback_width - 12;
+    std::vector<echo::COLOR> barColors(maxBars, echo::COLOR(echo::COLOR::BLUE));
+
+    Playback mirror;                        // what runTimestamp reads (pause flag + start time), kept in sync from STATUS frames
+    std::unique_ptr<Music> music;           // tags + cover only, the daemon has the samples
+    WaveformPyramid waveform;               // from the cache the daemon filled
+    std::thread progress;
+    std::vector<float> levels(wire::BANDS); // STATUS levels back to 0..1, refilled per frame
+
+    auto stopProgress = [&]() {
+        mirror.isPlaying = false;
+        if (progress.joinable()) progress.join();
+    };
+
+    std::string goodbye;                    // why we left when it wasn't 'q'
+    bool attached = true;
+    while (attached) {
+        bool sent = true;
+        switch (readKey()) {
+            case 'q': case 'Q':         attached = false; break;           // detach, the daemon keeps playing
+            case 'x': case 'X':         sent = engine.send(wire::SHUTDOWN); break;
+            case 'p': case 'P': case ' ': sent = engine.send(wire::PAUSE); break;
+            case 'b': case 'B':         sent = engine.send(wire::BACK); break;
+            case KEY_RIGHT:             sent = engine.send(wire::NEXT); break;
+            case KEY_LEFT:              sent = engine.send(wire::RESTART); break;
+            default: break;
+        }
+        if (!sent) { goodbye = "AsciiAmp daemon went away"; break; }
+        if (!attached) break;
+
+        // short wait so keys stay responsive, frames arrive at the daemon's 25 FPS anyway
+        if (!engine.receive(std::chrono::milliseconds(10))) { goodbye = "AsciiAmp daemon went away"; break; }
+
+        uint8_t type;
+        std::string payload;
+        std::vector<int> bars;              // only the newest frame gets drawn when several queued up
+        while (attached && engine.next(type, payload)) {
+            if (type == wire::HELLO) {
+                if (!wire::checkHello(payload)) { goodbye = "The daemon speaks another protocol version, restart it"; attached = false; break; }
+            } else if (type == wire::TRACK) {
+                wire::Track track = wire::decodeTrack(payload);
+                stopProgress();
+
+                music = std::make_unique<Music>();
+                music->readTags(track.path);
+                waveform.load(cache::pathFor(track.path, ".wave"), cache::keyFor(track.path), track.samples); // empty (plain bar) without a cache
+
+                screenInit(*music, title, ui, opts.palette, opts.dither);
+                std::string hint = "Attached to " + opts.socketPath + "  [Q] Detach  [X] Stop daemon";
+                Compositor::submit(ui, [&title, hint]() {
+                    title.print(3, getPadding(hint, title.get_w()), format(hint, DIM_BOLD));
+                    title.render(true);
+                });
+
+                mirror.pause.store(false);
+                mirror.startTime.store(std::chrono::steady_clock::now());
+                mirror.isPlaying = true;
+                progress = std::thread(runTimestamp, std::ref(playback), std::ref(progressUi), std::cref(*music), std::cref(mirror), std::cref(waveform), playback_width, bar_width, starting_col);
+            } else if (type == wire::STATUS) {
+                wire::Status status = wire::decodeStatus(payload);
+                mirror.startTime.store(std::chrono::steady_clock::now() - std::chrono::milliseconds(status.positionMs)); // before the flag, paused or not
+                mirror.pause.store(status.paused);
+                if (status.paused) { bars.clear(); continue; }
+
+                for (int i = 0; i < wire::BANDS; i++) levels[i] = status.levels[i] / 255.0f;
+                bars = SpectrumAnalyzer::toBars(levels, maxBars, fft.get_h());
+            }
+        }
+
+        if (!bars.empty()) {
+            Compositor::submit(ui, [&fft, &barColors, barWidth, bars = std::move(bars)]() {
+                Viz::draw_bars(fft, bars, barWidth, barColors, '#');
+                fft.render();
+            });
+        }
+    }
+
+    stopProgress();
+    compositor.stop();
+    tv::reset_cursor();
+    if (!goodbye.empty()) std::cout << goodbye << std::endl;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,143 @@
+# pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+    #include <io.h>
+    #define ASCIIAMP_WRITE _write
+    #define ASCIIAMP_STDOUT 1
+#else
+    #include <unistd.h>
+    #define ASCIIAMP_WRITE ::write
+    #define ASCIIAMP_STDOUT STDOUT_FILENO
+#endif
+
+// single producer / single consumer ring, the producer never blocks on a lock held by the consumer (or vice versa)
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    std::array<T, Capacity> slots;
+    alignas(64) std::atomic<size_t> head{0};                                // next slot to read (consumer)
+    alignas(64) std::atomic<size_t> tail{0};                                // next slot to write (producer)
+
+public:
+    bool push(T&& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == Capacity) return false; // full
+
+        slots[t & (Capacity - 1)] = std::move(item);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;        // empty
+
+        item = std::move(slots[h & (Capacity - 1)]);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+// collects everything written to std::cout during a frame (echo renders through it), never flushes on its own
+class FrameBuffer : public std::streambuf {
+    std::string frame;                                                      // reused every frame, only grows
+
+protected:
+    int_type overflow(int_type ch) override {
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) frame.push_back(traits_type::to_char_type(ch));
+        return ch;
+    }
+
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        frame.append(s, (size_t)n);
+        return n;
+    }
+
+    int sync() override { return 0; }                                       // std::flush/std::endl inside echo: wait for the frame
+
+public:
+    // one write() for the whole frame (loops only if the terminal takes it in pieces)
+    void flush() {
+        size_t written = 0;
+        while (written < frame.size()) {
+            auto n = ASCIIAMP_WRITE(ASCIIAMP_STDOUT, frame.data() + written, (unsigned)(frame.size() - written));
+            if (n <= 0) break;
+            written += (size_t)n;
+        }
+        frame.clear();                                                      // keeps the capacity
+    }
+
+    bool empty() const { return frame.empty(); }
+};
+
+// The only thread allowed to touch the terminal once started. Producers (main loop, progress thread ...) each get
+// their own lock-free queue and submit draw commands (window print/draw/render calls), the compositor runs them
+// once per frame with std::cout redirected into a FrameBuffer, then writes the frame out in one syscall
+class Compositor {
+public:
+    using Command = std::function<void()>;
+    using Queue = SpscQueue<Command, 64>;
+
+private:
+    std::deque<Queue> queues;                                               // deque: queues never move once handed out
+    FrameBuffer buffer;
+    std::chrono::milliseconds frameTime;
+    std::atomic<bool> running{false};
+    std::thread worker;
+
+    void composeFrame() {
+        Command command;
+        for (Queue& queue : queues) {
+            while (queue.pop(command)) command();
+        }
+        if (!buffer.empty()) buffer.flush();
+    }
+
+    void run() {
+        std::streambuf* original = std::cout.rdbuf(&buffer);
+
+        auto next = std::chrono::steady_clock::now();
+        while (running.load()) {
+            composeFrame();
+            next += frameTime;
+            std::this_thread::sleep_until(next);
+        }
+        composeFrame(); // whatever was submitted before stop()
+
+        std::cout.rdbuf(original);
+    }
+
+public:
+    explicit Compositor(std::chrono::milliseconds frameTime = std::chrono::milliseconds(20)) : frameTime(frameTime) {}
+    ~Compositor() { stop(); }
+
+    // one queue per producing thread, hand them all out before start()
+    Queue& queue() { return queues.emplace_back(); }
+
+    void start() {
+        running = true;
+        worker = std::thread(&Compositor::run, this);
+    }
+
+    // drains the queues one last time and gives std::cout back to the caller
+    void stop() {
+        if (!running.exchange(false)) return;
+        worker.join();
+    }
+
+    // producer side: waits (yielding) while the compositor catches up with a full queue
+    static void submit(Queue& queue, Command command) {
+        while (!queue.push(std::move(command))) std::this_thread::yield();
+    }
+};
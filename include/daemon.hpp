@@ -0,0 +1,104 @@
+# pragma once
+
+#ifndef _WIN32
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include <csignal>
+
+#include <music.hpp>
+#include <playback.hpp>
+#include <analyzer.hpp>
+#include <loudness.hpp>
+#include <options.hpp>
+#include <utils.hpp>
+#include <player.hpp>
+#include <ipc.hpp>
+
+namespace daemon_signals {
+    inline volatile std::sig_atomic_t stop = 0;                             // SIGTERM / SIGINT arrived
+    inline void request(int) { stop = 1; }
+}
+
+// --daemon: the playback loop of main without a screen. Owns the decoder, the ma_device, loudness and the spectrum
+// analysis, serves controls + one STATUS stream to any number of --attach clients (they come and go, playback doesn't care)
+// Logs to stdout, run it in the background / from a service manager
+int runDaemon(const Options& opts) {
+    std::vector<fs::path> musicLibrary = getMP3Files(opts.musicDir);
+    if (musicLibrary.empty()) throw std::invalid_argument("No mp3 files in " + opts.musicDir);
+
+    ipc::Server server(opts.socketPath);
+    signal(SIGHUP, SIG_IGN);                                                // the terminal it was started from closing is no reason to stop
+    signal(SIGTERM, daemon_signals::request);                               // kill / Ctrl+C stop it like SHUTDOWN, so the socket gets removed
+    signal(SIGINT, daemon_signals::request);
+    std::cout << "AsciiAmp daemon: " << musicLibrary.size() << " tracks, listening on " << opts.socketPath << std::endl;
+
+    // only once the socket is bound: its umask(0077) window would otherwise apply to the cache files the scanner creates
+    std::unique_ptr<LoudnessScanner> loudnessScanner;
+    if (opts.normalize) loudnessScanner = std::make_unique<LoudnessScanner>(musicLibrary, opts.realtime);
+
+    std::unique_ptr<SpectrumAnalyzer> analyzer = makeAnalyzer(opts.fftSize); // one analysis pass, shared by every client
+    const std::chrono::milliseconds frameTime(1000 / 25);                  // STATUS rate, same as the local visualizer
+
+    // main's playback loop, the socket takes the place of the keyboard and the screen
+    Player player(opts, (long)musicLibrary.size(), [&](long index, int deviceRate) {
+        return loadTrack(musicLibrary[index], opts.realtime, deviceRate);   // also fills the waveform cache clients draw from
+    });
+    Playback& playbackInfo = player.playback;
+    player.analyzer = analyzer.get();
+
+    bool rtReported = true;
+    auto nextFrame = std::chrono::steady_clock::now();
+
+    player.onTrack = [&](long index, LoadedTrack& track) {
+        const Music& music = *track.music;
+        server.setTrack({ (uint32_t)index, (uint64_t)music.monoSamples.size(), musicLibrary[index].string() });
+        std::cout << "Playing: " << music.artist << " - " << music.title << std::endl;
+        rtReported = !opts.realtime.enabled;
+    };
+
+    player.onFrame = [&]() {
+        if (daemon_signals::stop) { player.quit(); return; }
+
+        for (uint8_t command : server.poll(nextFrame)) { // returns early on a command, so controls don't wait for a frame
+            switch (command) {
+                case wire::NEXT:     player.next(); break;
+                case wire::BACK:     player.back(); break;
+                case wire::PAUSE:    playbackInfo.togglePause(); break;
+                case wire::RESTART:  playbackInfo.restart(); break;
+                case wire::SHUTDOWN: player.quit(); return;
+                default: break;                                             // unknown byte (newer client), ignore
+            }
+        }
+
+        if (!rtReported && playbackInfo.audioStatus.load() >= 0) {
+            const LoadedTrack& track = player.track();
+            std::cout << realtimeReport(playbackInfo.audioStatus.load(), track.decodeStatus, track.lockStatus) << std::endl;
+            rtReported = true;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (now < nextFrame) return;
+        nextFrame = std::max(nextFrame + frameTime, now);                   // after a stall: carry on, don't burst
+
+        if (server.clients() == 0) return;                                  // nobody watching, no FFT
+
+        wire::Status status;
+        status.positionMs = (uint32_t)(playbackInfo.position() * 1000 / player.sampleRate());
+        status.paused = playbackInfo.pause.load();
+        if (!status.paused) {
+            const std::vector<float>& levels = analyzer->levels(playbackInfo, wire::BANDS, opts.spectrum, player.sampleRate());
+            for (int i = 0; i < wire::BANDS; i++) status.levels[i] = (uint8_t)(std::clamp(levels[i], 0.0f, 1.0f) * 255.0f);
+        }
+        server.broadcast(wire::encode(status), true);
+    };
+
+    player.run();
+    std::cout << "AsciiAmp daemon: stopped" << std::endl;
+    return 0;
+}
+
+#endif
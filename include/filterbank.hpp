@@ -0,0 +1,111 @@
+# pragma once
+
+#include <vector>
+#include <map>
+#include <tuple>
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+
+enum class Spectrum : uint8_t {
+    LINEAR,                                                                 // original pow(x, 1.5) binning over the FFT bins
+    MEL,                                                                    // bands equally spaced on the mel scale
+    CONSTANT_Q                                                              // bands equally spaced in octaves (musical notes)
+};
+
+// Compressed sparse row matrix: bands x FFT bins, only the bins inside a band's triangle are stored
+// so applying it per frame costs the non-zeros (~nfft/2 in total) instead of bands * bins
+struct SparseMatrix {
+    int rows = 0, cols = 0;
+    std::vector<int> rowStart;                                              // rows + 1 offsets into column/weight
+    std::vector<int> column;
+    std::vector<float> weight;
+
+    void apply(const float* in, float* out) const {
+        for (int r = 0; r < rows; r++) {
+            float sum = 0.0f;
+            for (int k = rowStart[r]; k < rowStart[r + 1]; k++) sum += weight[k] * in[column[k]];
+            out[r] = sum;
+        }
+    }
+};
+
+namespace filterbank {
+
+inline float hzToMel(float hz) { return 2595.0f * std::log10(1.0f + hz / 700.0f); }
+inline float melToHz(float mel) { return 700.0f * (std::pow(10.0f, mel / 2595.0f) - 1.0f); }
+
+// triangular filters over 'edges' (bands + 2 frequencies, band b rises from edges[b] to edges[b+1] and falls to edges[b+2])
+// every row is normalised to sum 1 so a band's value is a weighted average of its bins (same scale as linear mode)
+inline SparseMatrix fromEdges(const std::vector<float>& edges, int sampleRate, int nfft) {
+    SparseMatrix matrix;
+    matrix.rows = (int)edges.size() - 2;
+    matrix.cols = nfft / 2;
+    matrix.rowStart.push_back(0);
+
+    float binHz = (float)sampleRate / nfft;
+
+    for (int b = 0; b < matrix.rows; b++) {
+        float lo = edges[b], center = edges[b + 1], hi = edges[b + 2];
+        size_t rowBegin = matrix.weight.size();
+
+        int first = std::max(0, (int)std::ceil(lo / binHz));
+        int last = std::min(matrix.cols - 1, (int)std::floor(hi / binHz));
+
+        for (int bin = first; bin <= last; bin++) {
+            float f = bin * binHz;
+            float w = (f <= center) ? (f - lo) / std::max(center - lo, 1e-6f) : (hi - f) / std::max(hi - center, 1e-6f);
+            if (w <= 0.0f) continue;
+
+            matrix.column.push_back(bin);
+            matrix.weight.push_back(w);
+        }
+
+        if (matrix.weight.size() == rowBegin) { // band narrower than one bin (low end): take the nearest bin
+            matrix.column.push_back(std::clamp((int)std::lround(center / binHz), 0, matrix.cols - 1));
+            matrix.weight.push_back(1.0f);
+        }
+
+        float total = 0.0f;
+        for (size_t k = rowBegin; k < matrix.weight.size(); k++) total += matrix.weight[k];
+        for (size_t k = rowBegin; k < matrix.weight.size(); k++) matrix.weight[k] /= total;
+
+        matrix.rowStart.push_back((int)matrix.weight.size());
+    }
+
+    return matrix;
+}
+
+inline SparseMatrix mel(int sampleRate, int nfft, int bands, float fmin = 20.0f, float fmax = 16000.0f) {
+    fmax = std::min(fmax, sampleRate / 2.0f);
+    float melLo = hzToMel(fmin), melHi = hzToMel(fmax);
+
+    std::vector<float> edges(bands + 2);
+    for (int i = 0; i < bands + 2; i++) edges[i] = melToHz(melLo + (melHi - melLo) * i / (bands + 1));
+
+    return fromEdges(edges, sampleRate, nfft);
+}
+
+inline SparseMatrix constantQ(int sampleRate, int nfft, int bands, float fmin = 32.7f, float fmax = 16000.0f) { // fmin = C1
+    fmax = std::min(fmax, sampleRate / 2.0f);
+    float ratio = std::pow(fmax / fmin, 1.0f / (bands + 1));                // constant ratio between neighbouring bands
+
+    std::vector<float> edges(bands + 2);
+    for (int i = 0; i < bands + 2; i++) edges[i] = fmin * std::pow(ratio, (float)i);
+
+    return fromEdges(edges, sampleRate, nfft);
+}
+
+// built once per (mode, sample rate, FFT size, band count) and reused for every frame after that
+inline const SparseMatrix& get(Spectrum mode, int sampleRate, int nfft, int bands) {
+    static std::map<std::tuple<Spectrum, int, int, int>, SparseMatrix> matrices;
+
+    auto key = std::make_tuple(mode, sampleRate, nfft, bands);
+    auto found = matrices.find(key);
+    if (found != matrices.end()) return found->second;
+
+    SparseMatrix matrix = (mode == Spectrum::MEL) ? mel(sampleRate, nfft, bands) : constantQ(sampleRate, nfft, bands);
+    return matrices.emplace(key, std::move(matrix)).first->second;
+}
+
+}
@@ -2,6 +2,10 @@
 
 #include <iostream>
 #include <vector>
+#include <array>
+#include <string>
+#include <cstdint>
+#include <algorithm>
 #include <stb_image.h>
 #include <echo.hpp> // for colors
 
@@ -10,6 +14,66 @@ enum SAMPLE : uint8_t {
     BOX                                                                     // averaging over the kernel area
 };
 
+enum PALETTE : uint8_t {
+    TRUECOLOR,                                                              // \033[38;2;R;G;Bm per cell (~19 bytes)
+    XTERM_256,                                                              // \033[38;5;Nm, 6x6x6 cube + 24 grays
+    ANSI_16                                                                 // \033[3Xm / \033[9Xm, works everywhere
+};
+
+// RGB -> palette index lookup cube (5 bits per channel, 32KB), nearest color is searched once per cell of the cube
+// instead of once per pixel per repaint
+class PaletteLUT {
+    std::array<uint8_t, 32 * 32 * 32> cube;
+
+    PaletteLUT(PALETTE palette) {
+        int first = (palette == ANSI_16) ? 0 : 16;                          // 0-15 are themed by the terminal, only trust them in 16 color mode
+        int last = (palette == ANSI_16) ? 16 : 256;
+
+        for (int r = 0; r < 32; r++) {
+            for (int g = 0; g < 32; g++) {
+                for (int b = 0; b < 32; b++) {
+                    int cr = r * 8 + 4, cg = g * 8 + 4, cb = b * 8 + 4;     // center of the cell
+                    int best = first, bestDistance = INT32_MAX;
+
+                    for (int i = first; i < last; i++) {
+                        std::array<uint8_t, 3> p = rgb(i);
+                        int dr = cr - p[0], dg = cg - p[1], db = cb - p[2];
+                        int distance = 2 * dr * dr + 4 * dg * dg + 3 * db * db; // rough perceptual weighting (eye is greenest)
+                        if (distance < bestDistance) { bestDistance = distance; best = i; }
+                    }
+                    cube[(r << 10) | (g << 5) | b] = (uint8_t)best;
+                }
+            }
+        }
+    }
+
+public:
+    // xterm's default RGB for a palette index
+    static std::array<uint8_t, 3> rgb(int index) {
+        static constexpr uint8_t SYSTEM[16][3] = {
+            {0, 0, 0}, {205, 0, 0}, {0, 205, 0}, {205, 205, 0}, {0, 0, 238}, {205, 0, 205}, {0, 205, 205}, {229, 229, 229},
+            {127, 127, 127}, {255, 0, 0}, {0, 255, 0}, {255, 255, 0}, {92, 92, 255}, {255, 0, 255}, {0, 255, 255}, {255, 255, 255}
+        };
+        static constexpr uint8_t LEVELS[6] = {0, 95, 135, 175, 215, 255};
+
+        if (index < 16) return {SYSTEM[index][0], SYSTEM[index][1], SYSTEM[index][2]};
+        if (index < 232) {
+            int c = index - 16;
+            return {LEVELS[c / 36], LEVELS[(c / 6) % 6], LEVELS[c % 6]};
+        }
+        uint8_t gray = (uint8_t)(8 + (index - 232) * 10);
+        return {gray, gray, gray};
+    }
+
+    static const PaletteLUT& get(PALETTE palette) { // built on first use only
+        if (palette == ANSI_16) { static const PaletteLUT ansi16(ANSI_16); return ansi16; }
+        static const PaletteLUT xterm256(XTERM_256);
+        return xterm256;
+    }
+
+    uint8_t lookup(int r, int g, int b) const { return cube[((r >> 3) << 10) | ((g >> 3) << 5) | (b >> 3)]; }
+};
+
 class Image {
     std::vector<uint8_t> rgb_pixels; // data is in 1D array [R,G,B,R,G,B ....] format
     int width = 0, height = 0, channels = 0;
@@ -73,6 +137,33 @@ class Image {
         return std::move(sample);
     }
 
+    // contrast curve + luminance -> glyph for one pixel, writes the adjusted color into r/g/b
+    char shade(const uint8_t* pixel, float contrast, float midpoint, int& r, int& g, int& b) {
+        static constexpr char CHAR_MAP[] = "o%&8#@$";
+
+        // 1. Normalize to 0.0 - 1.0 range
+        float r_norm = pixel[0] / 255.0f;
+        float g_norm = pixel[1] / 255.0f;
+        float b_norm = pixel[2] / 255.0f;
+
+        // 2. Apply Sigmoid (using 'contrast' as the k-factor)
+        r_norm = sigmoid(r_norm, contrast, midpoint);
+        g_norm = sigmoid(g_norm, contrast, midpoint);
+        b_norm = sigmoid(b_norm, contrast, midpoint);
+
+        // 3. Scale back and Clamp with your Floor
+        r = std::clamp((int)(r_norm * 255.0f), 15, 255);
+        g = std::clamp((int)(g_norm * 255.0f), 15, 255);
+        b = std::clamp((int)(b_norm * 255.0f), 15, 255);
+        
+        // general formula idk how it was derived
+        float luminance = (0.2126f * r + 0.7152f * g + 0.0722f * b) / 255.0f;
+
+        // based on luminance we'll map the pixel with some char from CHAR_MAP 0 being the dimmest to eventually getting lighter
+        int index = static_cast<int>(luminance * (sizeof(CHAR_MAP) - 2)); // as each char takes 1 byte we do not need to divide by CHAR_MAP[0]
+        return CHAR_MAP[index];
+    }
+
     Image(int w, int h, int c, std::vector<uint8_t> pixels): width(w), height(h), channels(c), rgb_pixels(std::move(pixels)) {}
 public:
     
@@ -173,8 +264,6 @@ public:
         // Increase contrast to make it punchier
         // Decrease brightness to "darken" the detection
         
-        static constexpr char CHAR_MAP[] = "o%&8#@$";
-        
         // We use 'brightness' to shift the midpoint (default is 0.5f)
         midpoint = midpoint - (brightness / 100.0f); // tweak brightness to shift the curve (lower midpoint makes everything move towards a light color range)
 
@@ -186,37 +275,59 @@ public:
 
         for (int y = 0; y < height; y++) {
             for (int x = 0; x < width; x++) { // moving pixel by pixel
-                uint8_t* pixel = at(x, y);
-
-                // 1. Normalize to 0.0 - 1.0 range
-                float r_norm = pixel[0] / 255.0f;
-                float g_norm = pixel[1] / 255.0f;
-                float b_norm = pixel[2] / 255.0f;
-
-                // 2. Apply Sigmoid (using 'contrast' as the k-factor)
-                r_norm = sigmoid(r_norm, contrast, midpoint);
-                g_norm = sigmoid(g_norm, contrast, midpoint);
-                b_norm = sigmoid(b_norm, contrast, midpoint);
-
-                // 3. Scale back and Clamp with your Floor
-                int r = std::clamp((int)(r_norm * 255.0f), 15, 255);
-                int g = std::clamp((int)(g_norm * 255.0f), 15, 255);
-                int b = std::clamp((int)(b_norm * 255.0f), 15, 255);
-                
-                // general formula idk how it was derived
-                float luminance = (0.2126f * r + 0.7152f * g + 0.0722f * b) / 255.0f;
-
-                // based on luminance we'll map the pixel with some char from CHAR_MAP 0 being the dimmest to eventually getting lighter
-                int index = static_cast<int>(luminance * (sizeof(CHAR_MAP) - 2)); // as each char takes 1 byte we do not need to divide by CHAR_MAP[0]
+                int r, g, b;
+                char ch = shade(at(x, y), contrast, midpoint, r, g, b);
                 
                 // Add ANSI TrueColor codes
                 // Format: \033[38;2;R;G;Bm
                 colors.emplace_back(r, g, b); // creates COLOR object and stores (reduces copies since everything inplace)
-                chars.emplace_back(CHAR_MAP[index]);
+                chars.emplace_back(ch);
             }
         }
         return {std::move(chars), std::move(colors)};
     }
 
+    // same art as toAscii but quantised to a palette and returned as ready to print rows
+    // a color escape is only emitted when the color changes from the previous cell (run-length coalescing)
+    std::vector<std::string> toAnsi(PALETTE palette, bool dither=false, float contrast=10.0f, float brightness=10.0f, float midpoint=0.35f) {
+        static constexpr int BAYER[4][4] = { {0, 8, 2, 10}, {12, 4, 14, 6}, {3, 11, 1, 9}, {15, 7, 13, 5} };
+        const int spread = (palette == ANSI_16) ? 96 : 40;                  // ~ distance between neighbouring palette levels
+
+        midpoint = midpoint - (brightness / 100.0f);
+        const PaletteLUT& lut = PaletteLUT::get(palette);
+
+        std::vector<std::string> rows;
+        rows.reserve(height);
+
+        for (int y = 0; y < height; y++) {
+            std::string row;
+            row.reserve(width * 4);
+            int previous = -1;
+
+            for (int x = 0; x < width; x++) {
+                int r, g, b;
+                char ch = shade(at(x, y), contrast, midpoint, r, g, b);
+
+                if (dither) { // ordered dithering: nudge by the Bayer threshold so flat gradients don't band
+                    int offset = (BAYER[y & 3][x & 3] * 2 - 15) * spread / 32;
+                    r = std::clamp(r + offset, 0, 255);
+                    g = std::clamp(g + offset, 0, 255);
+                    b = std::clamp(b + offset, 0, 255);
+                }
+
+                int index = lut.lookup(r, g, b);
+                if (index != previous) {
+                    if (palette == ANSI_16) row += "\033[" + std::to_string(index < 8 ? 30 + index : 90 + index - 8) + "m";
+                    else row += "\033[38;5;" + std::to_string(index) + "m";
+                    previous = index;
+                }
+                row.push_back(ch);
+            }
+            row += "\033[0m";
+            rows.push_back(std::move(row));
+        }
+        return rows;
+    }
+
 
 };
\ No newline at end of file
@@ -0,0 +1,334 @@
+# pragma once
+
+// Daemon <-> client link over a local Unix socket (POSIX only, the single process mode works everywhere)
+//
+// client -> daemon: one byte per control (wire::Command)
+// daemon -> client: frames of [type u8][payload length u16][payload], native byte order (both ends share a machine)
+//   HELLO   magic u32, version u8                                          once, right after accept
+//   TRACK   library index u32, sample count u64, path (rest of payload)    on attach and on every track change
+//   STATUS  position ms u32, paused u8, BANDS spectrum levels u8           every visualizer frame (~56 bytes)
+
+#ifndef _WIN32
+
+#include <string>
+#include <vector>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <cerrno>
+#include <stdexcept>
+#include <algorithm>
+
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+namespace wire {
+
+constexpr uint32_t MAGIC = 0x50414141;                                      // "AAAP"
+constexpr uint8_t VERSION = 1;
+constexpr int BANDS = 48;                                                   // spectrum resolution on the wire, clients resample to their bar count
+
+enum Command : uint8_t { NEXT = 'n', BACK = 'b', PAUSE = 'p', RESTART = 'r', SHUTDOWN = 'x' };
+enum FrameType : uint8_t { HELLO = 1, TRACK = 2, STATUS = 3 };
+
+struct Track {
+    uint32_t index = 0;                                                     // position in the daemon's library
+    uint64_t samples = 0;                                                   // decoded length, finds the daemon's waveform cache
+    std::string path;
+};
+
+struct Status {
+    uint32_t positionMs = 0;
+    bool paused = false;
+    std::array<uint8_t, BANDS> levels{};                                    // SpectrumAnalyzer::levels() scaled to 0..255
+};
+
+template <typename T>
+void append(std::string& out, const T& value) { out.append(reinterpret_cast<const char*>(&value), sizeof(T)); }
+
+template <typename T>
+T read(const std::string& in, size_t offset) {
+    T value{};
+    if (offset + sizeof(T) <= in.size()) std::memcpy(&value, in.data() + offset, sizeof(T));
+    return value;
+}
+
+inline std::string frame(FrameType type, const std::string& payload) {
+    std::string out;
+    append(out, (uint8_t)type);
+    append(out, (uint16_t)std::min(payload.size(), (size_t)UINT16_MAX));
+    out.append(payload, 0, UINT16_MAX);
+    return out;
+}
+
+inline std::string hello() {
+    std::string payload;
+    append(payload, MAGIC);
+    append(payload, VERSION);
+    return frame(HELLO, payload);
+}
+
+inline std::string encode(const Track& track) {
+    std::string payload;
+    append(payload, track.index);
+    append(payload, track.samples);
+    payload += track.path;
+    return frame(TRACK, payload);
+}
+
+inline std::string encode(const Status& status) {
+    std::string payload;
+    append(payload, status.positionMs);
+    append(payload, (uint8_t)status.paused);
+    payload.append(reinterpret_cast<const char*>(status.levels.data()), status.levels.size());
+    return frame(STATUS, payload);
+}
+
+inline bool checkHello(const std::string& payload) { return read<uint32_t>(payload, 0) == MAGIC && read<uint8_t>(payload, 4) == VERSION; }
+
+inline Track decodeTrack(const std::string& payload) {
+    Track track;
+    track.index = read<uint32_t>(payload, 0);
+    track.samples = read<uint64_t>(payload, 4);
+    if (payload.size() > 12) track.path = payload.substr(12);
+    return track;
+}
+
+inline Status decodeStatus(const std::string& payload) {
+    Status status;
+    status.positionMs = read<uint32_t>(payload, 0);
+    status.paused = read<uint8_t>(payload, 4) != 0;
+    for (int i = 0; i < BANDS && 5 + (size_t)i < payload.size(); i++) status.levels[i] = (uint8_t)payload[5 + i];
+    return status;
+}
+
+// reassembles frames from whatever the socket handed over so far
+class FrameParser {
+    std::string buffer;
+
+public:
+    void feed(const char* data, size_t length) { buffer.append(data, length); }
+
+    bool next(uint8_t& type, std::string& payload) {
+        if (buffer.size() < 3) return false;
+        uint16_t length = read<uint16_t>(buffer, 1);
+        if (buffer.size() < 3 + (size_t)length) return false;
+
+        type = (uint8_t)buffer[0];
+        payload.assign(buffer, 3, length);
+        buffer.erase(0, 3 + (size_t)length);
+        return true;
+    }
+};
+
+}
+
+namespace ipc {
+
+// $XDG_RUNTIME_DIR/asciiamp.sock (per user, cleaned up at logout), /tmp/asciiamp-<uid>.sock without it
+inline std::string defaultSocketPath() {
+    if (const char* runtime = std::getenv("XDG_RUNTIME_DIR"); runtime && *runtime) return std::string(runtime) + "/asciiamp.sock";
+    return "/tmp/asciiamp-" + std::to_string(getuid()) + ".sock";
+}
+
+inline sockaddr_un addressOf(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) throw std::invalid_argument("Socket path too long: " + path);
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+inline void setNonBlocking(int fd) { fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK); }
+
+// connected socket or -1 when nobody listens there
+inline int connectTo(const std::string& path) {
+    sockaddr_un address = addressOf(path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Daemon side. Never blocks on a client: output is queued per client and written as the socket accepts it, a client
+// that stops reading (stalled terminal, suspended process) loses STATUS frames instead of slowing playback down
+class Server {
+    struct Peer {
+        int fd;
+        std::string outbox;                                                 // frames the socket didn't take yet
+        bool dead = false;
+    };
+
+    static constexpr size_t MAX_BACKLOG = 64 * 1024;                        // behind by this much: STATUS frames are skipped
+    static constexpr size_t MAX_STALL = 1024 * 1024;                        // and by this much: disconnected
+
+    std::string path;
+    int listener = -1;
+    std::vector<Peer> peers;
+    std::string trackFrame;                                                 // current track, sent to every newcomer
+
+    static void flush(Peer& peer) {
+        while (!peer.dead && !peer.outbox.empty()) {
+            ssize_t n = ::write(peer.fd, peer.outbox.data(), peer.outbox.size());
+            if (n > 0) { peer.outbox.erase(0, (size_t)n); continue; }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) break;
+            peer.dead = true;
+        }
+    }
+
+    void acceptPeers() {
+        int fd;
+        while ((fd = accept(listener, nullptr, nullptr)) >= 0) {
+            setNonBlocking(fd);
+            peers.push_back({ fd, wire::hello() + trackFrame });
+            flush(peers.back());
+        }
+    }
+
+    void dropDead() {
+        for (Peer& peer : peers) if (peer.dead) close(peer.fd);
+        peers.erase(std::remove_if(peers.begin(), peers.end(), [](const Peer& p) { return p.dead; }), peers.end());
+    }
+
+public:
+    explicit Server(const std::string& path) : path(path) {
+        // refuse to take over a running daemon's socket, a leftover from a crashed one is removed
+        if (int probe = connectTo(path); probe >= 0) {
+            close(probe);
+            throw std::runtime_error("An AsciiAmp daemon is already listening on " + path);
+        }
+        if (struct stat existing; lstat(path.c_str(), &existing) == 0) { // --socket pointed at a file by mistake: keep it
+            if (!S_ISSOCK(existing.st_mode)) throw std::runtime_error("Not replacing " + path + ", it exists and isn't a socket");
+            unlink(path.c_str());
+        }
+
+        signal(SIGPIPE, SIG_IGN);                                           // a client vanishing mid write is just EPIPE
+
+        sockaddr_un address = addressOf(path);
+        listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        mode_t mask = umask(0077);                                          // only this user may control the player
+        bool bound = listener >= 0 && bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+        umask(mask);
+
+        if (!bound || listen(listener, 8) != 0) {
+            if (listener >= 0) close(listener);
+            throw std::runtime_error("Could not listen on " + path + ": " + std::strerror(errno));
+        }
+        setNonBlocking(listener);
+    }
+
+    ~Server() {
+        for (Peer& peer : peers) close(peer.fd);
+        close(listener);
+        unlink(path.c_str());
+    }
+
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+    size_t clients() const { return peers.size(); }
+
+    // STATUS frames are droppable, everything else is queued no matter what
+    void broadcast(const std::string& frame, bool droppable) {
+        for (Peer& peer : peers) {
+            if (droppable && peer.outbox.size() > MAX_BACKLOG) continue;
+            peer.outbox += frame;
+            if (peer.outbox.size() > MAX_STALL) peer.dead = true;
+            flush(peer);
+        }
+        dropDead();
+    }
+
+    void setTrack(const wire::Track& track) {
+        trackFrame = wire::encode(track);
+        broadcast(trackFrame, false);
+    }
+
+    // sleeps until 'deadline' or the first command, accepts new clients and writes pending output meanwhile
+    std::vector<uint8_t> poll(std::chrono::steady_clock::time_point deadline) {
+        std::vector<uint8_t> commands;
+
+        while (commands.empty()) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+            if (left < 0) left = 0;
+
+            std::vector<pollfd> fds{ { listener, POLLIN, 0 } };
+            for (const Peer& peer : peers) fds.push_back({ peer.fd, (short)(POLLIN | (peer.outbox.empty() ? 0 : POLLOUT)), 0 });
+
+            if (::poll(fds.data(), fds.size(), (int)left) < 0 && errno != EINTR) break;
+
+            for (size_t i = 0; i < peers.size(); i++) { // peers before accepting, fds[i + 1] belongs to peers[i]
+                short revents = fds[i + 1].revents;
+                if (revents & (POLLIN | POLLHUP | POLLERR)) {
+                    char buffer[64];
+                    ssize_t n = ::read(peers[i].fd, buffer, sizeof(buffer));
+                    if (n > 0) commands.insert(commands.end(), buffer, buffer + n);
+                    else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) peers[i].dead = true;
+                }
+                if (revents & POLLOUT) flush(peers[i]);
+            }
+            if (fds[0].revents & POLLIN) acceptPeers();
+            dropDead();
+
+            if (left == 0) break;
+        }
+        return commands;
+    }
+};
+
+// Client side of the socket
+class Connection {
+    int fd = -1;
+    wire::FrameParser parser;
+
+public:
+    explicit Connection(const std::string& path) {
+        fd = connectTo(path);
+        if (fd < 0) throw std::runtime_error("No AsciiAmp daemon on " + path + " (start one with --daemon)");
+        setNonBlocking(fd);
+        signal(SIGPIPE, SIG_IGN);                                           // a key sent to a daemon that just quit is EPIPE, not death
+    }
+
+    ~Connection() { if (fd >= 0) close(fd); }
+
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    // false once the daemon is gone (EPIPE)
+    bool send(wire::Command command) {
+        uint8_t byte = command;
+        if (::write(fd, &byte, 1) == 1) return true;
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;  // full (dropped key) isn't gone
+    }
+
+    // waits up to 'timeout' for data and takes everything that arrived, false once the daemon is gone
+    bool receive(std::chrono::milliseconds timeout) {
+        pollfd pfd{ fd, POLLIN, 0 };
+        if (::poll(&pfd, 1, (int)timeout.count()) <= 0) return true;
+
+        char buffer[4096];
+        while (true) {
+            ssize_t n = ::read(fd, buffer, sizeof(buffer));
+            if (n > 0) { parser.feed(buffer, (size_t)n); continue; }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return true;
+            return false;                                                   // closed (0) or broken
+        }
+    }
+
+    bool next(uint8_t& type, std::string& payload) { return parser.next(type, payload); }
+};
+
+}
+
+#endif
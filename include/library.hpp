@@ -0,0 +1,197 @@
+# pragma once
+
+#include <filesystem>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <shared_mutex>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <iterator>
+#include <cctype>
+#include <cstdint>
+
+#include <taglib/mpegfile.h>
+
+namespace fs = std::filesystem;
+
+struct TrackInfo {
+    std::string title, artist, album;
+    fs::path path;
+    size_t libraryIndex;                                                    // position in musicLibrary (what the playback loop understands)
+};
+
+// In-memory search over title/artist/album/file name, grows while the scanner reads tags.
+// Words of 3+ chars go through a trigram index (substring search), 1-2 char words through token prefixes
+// (so the first keystrokes are already useful), candidates are intersected starting from the rarest key.
+class LibraryIndex {
+    struct Document {
+        TrackInfo info;
+        std::string fields[4];                                              // lowercase title, artist, album, file name
+    };
+
+    static constexpr float FIELD_WEIGHT[4] = { 4.0f, 3.0f, 2.0f, 1.0f };
+
+    std::vector<Document> documents;                                        // doc id = position
+    std::unordered_map<uint32_t, std::vector<uint32_t>> postings;           // key -> ascending doc ids
+    mutable std::shared_mutex mutex;                                        // scanner writes, UI reads
+
+    static std::string lower(const std::string& text) {
+        std::string out = text;
+        for (char& ch : out) ch = (char)std::tolower((unsigned char)ch);
+        return out;
+    }
+
+    static bool isWordChar(char ch) { return std::isalnum((unsigned char)ch) || (unsigned char)ch >= 0x80; } // keeps UTF-8 bytes in words
+
+    static uint32_t trigramKey(const char* s) { return ((uint8_t)s[0] << 16) | ((uint8_t)s[1] << 8) | (uint8_t)s[2]; }
+    static uint32_t prefixKey(const char* s, size_t len) { // outside the 24 bit trigram range
+        return 0x1000000u | ((uint32_t)len << 16) | ((uint8_t)s[0] << 8) | (len > 1 ? (uint8_t)s[1] : 0);
+    }
+
+    void post(uint32_t key, uint32_t doc) {
+        std::vector<uint32_t>& list = postings[key];
+        if (list.empty() || list.back() != doc) list.push_back(doc);       // docs arrive in order, so lists stay sorted
+    }
+
+    // best score of one query word over the fields, 0 when it isn't there
+    static float scoreWord(const Document& doc, const std::string& word) {
+        float best = 0.0f;
+        for (int f = 0; f < 4; f++) {
+            size_t pos = doc.fields[f].find(word);
+            if (pos == std::string::npos) continue;
+
+            bool wordStart = (pos == 0) || !isWordChar(doc.fields[f][pos - 1]);
+            best = std::max(best, FIELD_WEIGHT[f] * (wordStart ? 1.5f : 1.0f));
+        }
+        return best;
+    }
+
+    static std::vector<uint32_t> intersect(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) {
+        std::vector<uint32_t> out;
+        std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(out));
+        return out;
+    }
+
+public:
+    void add(TrackInfo info) {
+        Document doc{ std::move(info), {} };
+        doc.fields[0] = lower(doc.info.title);
+        doc.fields[1] = lower(doc.info.artist);
+        doc.fields[2] = lower(doc.info.album);
+        doc.fields[3] = lower(doc.info.path.stem().string());
+
+        std::unique_lock lock(mutex);
+        uint32_t id = (uint32_t)documents.size();
+
+        for (const std::string& field : doc.fields) {
+            for (size_t i = 0; i + 3 <= field.size(); i++) post(trigramKey(&field[i]), id);
+
+            for (size_t i = 0; i < field.size(); i++) { // 1 and 2 char prefixes of every word
+                if (!isWordChar(field[i]) || (i > 0 && isWordChar(field[i - 1]))) continue;
+                post(prefixKey(&field[i], 1), id);
+                if (i + 1 < field.size() && isWordChar(field[i + 1])) post(prefixKey(&field[i], 2), id);
+            }
+        }
+        documents.push_back(std::move(doc));
+    }
+
+    size_t size() const {
+        std::shared_lock lock(mutex);
+        return documents.size();
+    }
+
+    // ranked matches for every word of the query (AND), best first
+    std::vector<TrackInfo> search(const std::string& query, size_t limit = 10) const {
+        std::vector<std::string> words;
+        std::string word;
+        for (char ch : lower(query) + " ") {
+            if (ch == ' ') { if (!word.empty()) words.push_back(std::move(word)); word.clear(); }
+            else word.push_back(ch);
+        }
+        if (words.empty()) return {};
+
+        std::shared_lock lock(mutex);
+
+        // every key the query needs, rarest first so the running intersection shrinks as fast as possible
+        std::vector<const std::vector<uint32_t>*> lists;
+        for (const std::string& w : words) {
+            if (w.size() < 3) {
+                auto found = postings.find(prefixKey(w.data(), w.size()));
+                if (found == postings.end()) return {};
+                lists.push_back(&found->second);
+                continue;
+            }
+            for (size_t i = 0; i + 3 <= w.size(); i++) {
+                auto found = postings.find(trigramKey(&w[i]));
+                if (found == postings.end()) return {};
+                lists.push_back(&found->second);
+            }
+        }
+        std::sort(lists.begin(), lists.end(), [](auto* a, auto* b) { return a->size() < b->size(); });
+
+        std::vector<uint32_t> candidates = *lists.front();
+        for (size_t i = 1; i < lists.size() && !candidates.empty(); i++) candidates = intersect(candidates, *lists[i]);
+
+        // trigrams can match out of order, scoring doubles as the exact substring check
+        // broad queries (one or two letters) stop early once 'limit' documents reached the best possible score
+        const float perfect = FIELD_WEIGHT[0] * 1.5f * words.size();
+        size_t perfectCount = 0;
+
+        std::vector<std::pair<float, uint32_t>> ranked;
+        for (uint32_t id : candidates) {
+            float score = 0.0f;
+            for (const std::string& w : words) {
+                float s = scoreWord(documents[id], w);
+                if (s == 0.0f) { score = 0.0f; break; }
+                score += s;
+            }
+            if (score <= 0.0f) continue;
+
+            ranked.emplace_back(score, id);
+            if (score >= perfect && ++perfectCount >= limit) break;
+        }
+
+        size_t count = std::min(limit, ranked.size());
+        std::partial_sort(ranked.begin(), ranked.begin() + count, ranked.end(), [&](const auto& a, const auto& b) {
+            if (a.first != b.first) return a.first > b.first;
+            return documents[a.second].fields[0].size() < documents[b.second].fields[0].size(); // shorter title = closer match
+        });
+
+        std::vector<TrackInfo> results;
+        for (size_t i = 0; i < count; i++) results.push_back(documents[ranked[i].second].info);
+        return results;
+    }
+};
+
+// reads tags of every file in the background and feeds them to the index as it goes
+class LibraryScanner {
+    std::atomic<bool> running{true};
+    std::thread worker;
+
+public:
+    LibraryScanner(const std::vector<fs::path>& musicLibrary, LibraryIndex& index) {
+        worker = std::thread([this, &musicLibrary, &index]() {
+            for (size_t i = 0; i < musicLibrary.size() && running.load(); i++) {
+                TrackInfo info{ "", "", "", musicLibrary[i], i };
+
+                TagLib::MPEG::File f(musicLibrary[i].c_str());
+                if (f.isValid() && f.tag()) {
+                    info.title = f.tag()->title().to8Bit(true);
+                    info.artist = f.tag()->artist().to8Bit(true);
+                    info.album = f.tag()->album().to8Bit(true);
+                }
+                if (info.title.empty()) info.title = musicLibrary[i].stem().string(); // untagged files are still findable by name
+
+                index.add(std::move(info));
+            }
+        });
+    }
+
+    ~LibraryScanner() {
+        running = false;
+        worker.join();
+    }
+};
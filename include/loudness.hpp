@@ -0,0 +1,234 @@
+# pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include <music.hpp>
+#include <cache.hpp>
+#include <simd.hpp>
+#include <realtime.hpp>
+
+namespace fs = std::filesystem;
+
+// integrated loudness (LUFS, over the file's own channels) + sample peak of the mono mix we actually play
+struct Loudness {
+    static constexpr float SILENCE = -70.0f;                                // BS.1770 absolute gate, nothing quieter counts
+    static constexpr float MAX_BOOST = 12.0f;                               // dB, quiet intros/ambient tracks shouldn't get blasted
+    static constexpr float MAX_CUT = -24.0f;
+
+    float integrated = SILENCE;
+    float peak = 0.0f;                                                      // linear, 1.0 = full scale
+
+    // linear gain that brings the track to targetLufs, limited so the peak stays below full scale when 'limitToPeak'
+    float gainTo(float targetLufs, bool limitToPeak = true) const {
+        if (integrated <= SILENCE) return 1.0f;
+
+        float gain = std::pow(10.0f, std::clamp(targetLufs - integrated, MAX_CUT, MAX_BOOST) / 20.0f);
+        if (limitToPeak && peak > 0.0f) gain = std::min(gain, 1.0f / peak);
+        return gain;
+    }
+};
+
+// simplified ITU-R BS.1770: K-weighting per channel, channel powers summed (L/R weigh 1), 400ms blocks every 100ms,
+// absolute (-70 LUFS) + relative (-10 LU) gates
+namespace loudness {
+
+constexpr float DEFAULT_TARGET = -18.0f;                                    // ReplayGain 2.0 reference level
+
+constexpr uint32_t MAGIC = 0x4C444141;                                      // "AADL"
+constexpr uint32_t VERSION = 2;                                             // v1 measured the mono mix, ~3 dB low on stereo
+
+struct Biquad { // transposed direct form II, double state so the 38Hz high pass stays stable
+    double b0, b1, b2, a1, a2;
+    double z1 = 0.0, z2 = 0.0;
+
+    float process(float x) {
+        double y = b0 * x + z1;
+        z1 = b1 * x - a1 * y + z2;
+        z2 = b2 * x - a2 * y;
+        return (float)y;
+    }
+};
+
+// the two K-weighting stages (high shelf + RLB high pass) for any sample rate, not just the 48k table of the spec
+inline std::pair<Biquad, Biquad> kWeighting(int sampleRate) {
+    const double pi = 3.14159265358979323846;
+
+    double K = std::tan(pi * 1681.974450955533 / sampleRate);
+    double Q = 0.7071752369554196;
+    double Vh = std::pow(10.0, 3.999843853973347 / 20.0);
+    double Vb = std::pow(Vh, 0.4996667741545416);
+    double a0 = 1.0 + K / Q + K * K;
+    Biquad shelf{ (Vh + Vb * K / Q + K * K) / a0, 2.0 * (K * K - Vh) / a0, (Vh - Vb * K / Q + K * K) / a0,
+                  2.0 * (K * K - 1.0) / a0, (1.0 - K / Q + K * K) / a0 };
+
+    K = std::tan(pi * 38.13547087602444 / sampleRate);
+    Q = 0.5003270373238773;
+    a0 = 1.0 + K / Q + K * K;
+    Biquad highPass{ 1.0, -2.0, 1.0, 2.0 * (K * K - 1.0) / a0, (1.0 - K / Q + K * K) / a0 };
+
+    return { shelf, highPass };
+}
+
+inline float toLufs(double meanSquare) { return -0.691f + 10.0f * (float)std::log10(meanSquare); }
+
+// 'channels' as decodeChannels() returns them. Averaging stereo down first would cancel the +3 dB of two correlated
+// channels (and more of anything out of phase), so each one is weighted on its own and only the powers are summed
+inline Loudness measure(const std::vector<std::vector<float>>& channels, int sampleRate) {
+    Loudness result;
+    const size_t hop = (size_t)std::max(sampleRate / 10, 1);               // 100ms, a gating block is 4 hops
+    const size_t frames = channels.empty() ? 0 : channels.front().size();
+    if (frames == 0) return result;
+
+    std::vector<std::pair<Biquad, Biquad>> filters(channels.size(), kWeighting(sampleRate));
+    std::vector<float> weighted(hop), mono(hop);
+    std::vector<double> hopPower;                                           // K-weighted power (sum over channels) of every 100ms hop
+    hopPower.reserve(frames / hop + 1);
+
+    for (size_t start = 0; start < frames; start += hop) {
+        size_t n = std::min(hop, frames - start);
+        double power = 0.0;
+        float mn, mx, sumSq;
+        std::fill(mono.begin(), mono.begin() + n, 0.0f);
+
+        for (size_t c = 0; c < channels.size(); c++) {
+            const float* in = channels[c].data() + start;
+            auto& [shelf, highPass] = filters[c];
+
+            for (size_t i = 0; i < n; i++) {                                // recursive, stays scalar
+                weighted[i] = highPass.process(shelf.process(in[i]));
+                mono[i] += in[i] / channels.size();
+            }
+            simd::minMaxSumSq(weighted.data(), n, mn, mx, sumSq);
+            power += sumSq / n;
+        }
+
+        simd::minMaxSumSq(mono.data(), n, mn, mx, sumSq);                   // peak of what gets played
+        result.peak = std::max(result.peak, std::max(-mn, mx));
+
+        if (n == hop) hopPower.push_back(power);                            // a partial last hop would skew its blocks
+    }
+
+    // overlapping 400ms blocks, shorter tracks count as one block
+    std::vector<double> blocks;
+    if (hopPower.size() < 4) {
+        double sum = 0.0;
+        for (double p : hopPower) sum += p;
+        if (!hopPower.empty()) blocks.push_back(sum / hopPower.size());
+    }
+    for (size_t i = 3; i < hopPower.size(); i++) {
+        blocks.push_back((hopPower[i - 3] + hopPower[i - 2] + hopPower[i - 1] + hopPower[i]) / 4.0);
+    }
+
+    auto gatedMean = [&](float thresholdLufs, double& mean) {
+        double sum = 0.0;
+        size_t count = 0;
+        for (double b : blocks) {
+            if (b > 0.0 && toLufs(b) > thresholdLufs) { sum += b; count++; }
+        }
+        if (count == 0) return false;
+        mean = sum / count;
+        return true;
+    };
+
+    double mean;
+    if (!gatedMean(Loudness::SILENCE, mean)) return result;                 // silent track: integrated stays at SILENCE
+    if (!gatedMean(toLufs(mean) - 10.0f, mean)) return result;
+
+    result.integrated = toLufs(mean);
+    return result;
+}
+
+inline bool save(const fs::path& path, uint64_t key, const Loudness& value) {
+    fs::path partial = path.string() + ".part";                             // readers never see a half written entry
+    {
+        std::ofstream out(partial, std::ios::binary);
+        if (!out) return false;
+
+        out.write(reinterpret_cast<const char*>(&MAGIC), sizeof(MAGIC));
+        out.write(reinterpret_cast<const char*>(&VERSION), sizeof(VERSION));
+        out.write(reinterpret_cast<const char*>(&key), sizeof(key));
+        out.write(reinterpret_cast<const char*>(&value.integrated), sizeof(value.integrated));
+        out.write(reinterpret_cast<const char*>(&value.peak), sizeof(value.peak));
+        if (!out) return false;
+    }
+
+    std::error_code ec;
+    fs::rename(partial, path, ec);
+    return !ec;
+}
+
+inline bool load(const fs::path& path, uint64_t key, Loudness& value) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+
+    uint32_t magic = 0, version = 0;
+    uint64_t storedKey = 0;
+    Loudness stored;
+    in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    in.read(reinterpret_cast<char*>(&version), sizeof(version));
+    in.read(reinterpret_cast<char*>(&storedKey), sizeof(storedKey));
+    in.read(reinterpret_cast<char*>(&stored.integrated), sizeof(stored.integrated));
+    in.read(reinterpret_cast<char*>(&stored.peak), sizeof(stored.peak));
+
+    if (!in || magic != MAGIC || version != VERSION || storedKey != key) return false;
+    value = stored;
+    return true;
+}
+
+// what playback uses: the cached measurement or nothing, tracks are never analysed on the play path
+inline bool cached(const fs::path& track, Loudness& value) {
+    return load(cache::pathFor(track, ".loud"), cache::keyFor(track), value);
+}
+
+}
+
+// measures every track of the library in the background (one track per worker at a time) and caches the results,
+// a track that isn't done yet simply plays at unity gain. In low-latency mode the workers stay off the audio CPUs
+// (rt::backgroundCpus) and keep normal scheduling, they're batch work
+class LoudnessScanner {
+    static constexpr unsigned MAX_WORKERS = 4;                              // each one holds a whole decoded track
+
+    std::atomic<bool> running{true};
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> workers;
+
+public:
+    LoudnessScanner(const std::vector<fs::path>& musicLibrary, const rt::Config& realtime = {}) {
+        unsigned count = std::clamp(std::thread::hardware_concurrency() / 2, 1u, MAX_WORKERS); // leave cores for playback + UI
+        std::vector<int> cpus = rt::backgroundCpus(realtime);
+
+        for (unsigned w = 0; w < count; w++) {
+            workers.emplace_back([this, &musicLibrary, cpus]() {
+                rt::pinCurrentThread(cpus);                                 // best effort, a failure only costs latency headroom
+
+                while (running.load()) {
+                    size_t i = next.fetch_add(1);                           // library order = play order
+                    if (i >= musicLibrary.size()) break;
+
+                    const fs::path& track = musicLibrary[i];
+                    Loudness value;
+                    if (loudness::cached(track, value)) continue;
+
+                    try {
+                        int sampleRate;
+                        std::vector<std::vector<float>> channels = decodeChannels(track.string(), sampleRate);
+                        loudness::save(cache::pathFor(track, ".loud"), cache::keyFor(track), loudness::measure(channels, sampleRate));
+                    } catch (const std::exception&) {}                      // undecodable file: it'll fail loudly when played
+                }
+            });
+        }
+    }
+
+    ~LoudnessScanner() {
+        running = false;
+        for (std::thread& worker : workers) worker.join();
+    }
+};
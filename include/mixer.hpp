@@ -0,0 +1,202 @@
+# pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include <miniaudio.h>
+
+#include <simd.hpp>
+
+// Sums up to MAX_SOURCES mono sources inside the audio callback (no extra threads, no locks, no allocation)
+// Every source sits on an equal power curve: gain = sin(phase * pi/2), phase moves towards its target (0 or 1)
+// over 'fadeFrames', so a track fading in while another fades out keeps constant loudness
+//
+// Slot life cycle: FREE --add (main)--> ACTIVE --ended/faded out (audio)--> DONE --reclaim (main)--> FREE
+//                  FREE --queue (main)--> QUEUED --predecessor hit its fade point (audio)--> ACTIVE
+// the main thread only writes a slot's plain fields while it is FREE, the audio thread only reads them while QUEUED/ACTIVE
+class Mixer {
+public:
+    static constexpr int MAX_SOURCES = 4;                                   // current track + tracks still fading out (later: jingles)
+    static constexpr ma_uint32 BLOCK = 64;                                  // frames per gain step, the ramp inside a block is linear
+
+    std::atomic<size_t> fadeFrames{0};                                      // crossfade length, 0 = cut (still ramped over one BLOCK to avoid clicks)
+
+private:
+    enum State : uint8_t { FREE, QUEUED, ACTIVE, DONE };
+
+    struct Source {
+        const float* data = nullptr;
+        size_t length = 0;
+        std::shared_ptr<void> owner;                                        // keeps the samples alive, only touched by the main thread
+        float phase = 0.0f;                                                 // position on the fade curve, audio thread while ACTIVE
+        int after = -1;                                                     // QUEUED: the slot whose fade point starts this one
+        size_t delay = 0;                                                   // audio thread: frames of this callback before it starts
+
+        std::atomic<size_t> position{0};
+        std::atomic<float> target{1.0f};                                    // 1 = fade in / hold, 0 = fade out
+        std::atomic<float> level{1.0f};                                     // static gain on top of the fade
+        std::atomic<bool> cut{false};                                       // drop immediately (slots ran out)
+        std::atomic<bool> handover{false};                                  // a successor is queued: fade out at length - fadeFrames
+        std::atomic<bool> go{false};                                        // QUEUED: start on the next callback, don't wait
+        std::atomic<uint8_t> state{FREE};
+    };
+
+    std::array<Source, MAX_SOURCES> sources;
+
+    static float equalPower(float phase) { return std::sin(phase * 1.57079632679f); }
+
+public:
+    // main thread: starts a source (fading in, or at full level when 'fadeIn' is false), -1 when every slot is busy
+    // 'level' is the source's static gain from the first sample on (loudness normalisation)
+    int add(const float* data, size_t length, bool fadeIn, std::shared_ptr<void> owner, float level = 1.0f) {
+        return claim(data, length, fadeIn ? 0.0f : 1.0f, -1, std::move(owner), level, ACTIVE);
+    }
+
+    // main thread: a source that starts on its own, sample accurate, once 'after' reaches its fade point (length -
+    // fadeFrames): the crossfade starts on time however late the main loop looks, and a 0 crossfade is gapless
+    // -1 when every slot is busy or 'after' isn't playing
+    int queue(const float* data, size_t length, int after, std::shared_ptr<void> owner, float level = 1.0f) {
+        if (after < 0 || sources[after].state.load(std::memory_order_acquire) != ACTIVE) return -1;
+
+        int slot = claim(data, length, 0.0f, after, std::move(owner), level, QUEUED);
+        if (slot >= 0) sources[after].handover.store(true);
+        return slot;
+    }
+
+    bool started(int slot) const { return slot >= 0 && sources[slot].state.load(std::memory_order_acquire) != QUEUED; }
+    void startNow(int slot)      { if (slot >= 0) sources[slot].go.store(true); } // queued source: skip the wait
+
+    // main thread: drops a queued source (its predecessor plays to its end again), one that just started fades out
+    void unqueue(int slot) {
+        if (slot < 0) return;
+        Source& s = sources[slot];
+        if (s.after >= 0) sources[s.after].handover.store(false);
+        if (started(slot)) fadeOut(slot);
+        else s.cut.store(true);
+    }
+
+private:
+    int claim(const float* data, size_t length, float phase, int after, std::shared_ptr<void> owner, float level, State state) {
+        reclaim();
+
+        for (int i = 0; i < MAX_SOURCES; i++) {
+            Source& s = sources[i];
+            if (s.state.load(std::memory_order_acquire) != FREE) continue;
+
+            s.data = data;
+            s.length = length;
+            s.owner = std::move(owner);
+            s.phase = phase;
+            s.after = after;
+            s.delay = 0;
+            s.position.store(0, std::memory_order_relaxed);
+            s.target.store(1.0f, std::memory_order_relaxed);
+            s.level.store(level, std::memory_order_relaxed);
+            s.cut.store(false, std::memory_order_relaxed);
+            s.handover.store(false, std::memory_order_relaxed);
+            s.go.store(false, std::memory_order_relaxed);
+            s.state.store(state, std::memory_order_release);                // publishes everything above to the audio thread
+            return i;
+        }
+        return -1;
+    }
+
+    // audio thread: starts the queued sources whose predecessor reaches its fade point within this callback
+    void startQueued(ma_uint32 frames, size_t fade) {
+        for (Source& s : sources) {
+            if (s.state.load(std::memory_order_acquire) != QUEUED) continue;
+            if (s.cut.load(std::memory_order_relaxed)) { s.state.store(DONE, std::memory_order_release); continue; }
+
+            const Source& before = sources[s.after];
+            size_t delay = 0;
+            if (!s.go.load(std::memory_order_relaxed) && before.state.load(std::memory_order_acquire) == ACTIVE) {
+                size_t fadeAt = before.length - std::min(fade, before.length);
+                size_t pos = before.position.load(std::memory_order_relaxed);
+                if (pos + frames <= fadeAt) continue;                       // not in this callback
+                delay = (fadeAt > pos) ? fadeAt - pos : 0;
+            }
+            s.delay = delay;
+            s.phase = (fade || s.go.load(std::memory_order_relaxed)) ? 0.0f : 1.0f; // on time without crossfade: butt splice, nothing to ramp
+            s.state.store(ACTIVE, std::memory_order_release);
+        }
+    }
+
+public:
+    // main thread: frees the slots the audio thread is done with (and the tracks they kept alive)
+    void reclaim() {
+        for (Source& s : sources) {
+            if (s.state.load(std::memory_order_acquire) != DONE) continue;
+            s.owner.reset();
+            s.data = nullptr;
+            s.state.store(FREE, std::memory_order_release);
+        }
+    }
+
+    // main thread: drop every source except 'keep' on the next callback (used when no slot is free)
+    void cutAllExcept(int keep) {
+        for (int i = 0; i < MAX_SOURCES; i++) {
+            if (i != keep && sources[i].state.load(std::memory_order_acquire) == ACTIVE) sources[i].cut.store(true);
+        }
+    }
+
+    void fadeOut(int slot)                { if (slot >= 0) sources[slot].target.store(0.0f); }
+    void setLevel(int slot, float level)  { if (slot >= 0) sources[slot].level.store(level); }
+    void seek(int slot, size_t frame)     { if (slot >= 0) sources[slot].position.store(frame); }
+    size_t position(int slot) const       { return (slot >= 0) ? sources[slot].position.load() : 0; }
+    size_t length(int slot) const         { return (slot >= 0) ? sources[slot].length : 0; }
+
+    // audio thread: overwrites 'out' with the sum of all active sources
+    void mix(float* out, ma_uint32 frames) {
+        std::fill(out, out + frames, 0.0f);
+
+        size_t fade = fadeFrames.load(std::memory_order_relaxed);
+        float perFrame = 1.0f / (fade ? fade : BLOCK);                      // phase change per frame while fading
+
+        startQueued(frames, fade);
+
+        for (Source& s : sources) {
+            if (s.state.load(std::memory_order_acquire) != ACTIVE) continue;
+            if (s.cut.load(std::memory_order_relaxed)) { s.state.store(DONE, std::memory_order_release); continue; }
+
+            float target = s.target.load(std::memory_order_relaxed);
+            float level = s.level.load(std::memory_order_relaxed);
+            size_t start = s.position.load(std::memory_order_relaxed);
+            size_t pos = start;
+
+            // with a successor queued the fade out begins at the same frame it starts on (a cut just plays to the end)
+            size_t fadeAt = (fade && s.handover.load(std::memory_order_relaxed)) ? s.length - std::min(fade, s.length) : SIZE_MAX;
+
+            ma_uint32 done = (ma_uint32)std::min<size_t>(s.delay, frames);  // just started by startQueued
+            s.delay = 0;
+
+            while (done < frames && pos < s.length) {
+                if (pos >= fadeAt) target = 0.0f;
+                size_t n = std::min<size_t>({ (size_t)BLOCK, (size_t)(frames - done), s.length - pos });
+                if (pos < fadeAt) n = std::min(n, fadeAt - pos);           // the fade starts on a block boundary
+
+                // fading out steeper when the track ends first (a late fade), a source never stops while still audible
+                float rate = (target < s.phase) ? std::max(perFrame, s.phase / (s.length - pos)) : perFrame;
+                float delta = rate * n;
+                float next = (s.phase < target) ? std::min(target, s.phase + delta) : std::max(target, s.phase - delta);
+                float g0 = equalPower(s.phase) * level, g1 = equalPower(next) * level;
+
+                simd::mixRamp(out + done, s.data + pos, n, g0, (g1 - g0) / n);
+
+                s.phase = next;
+                pos += n;
+                done += (ma_uint32)n;
+                if (s.phase <= 0.0f && target <= 0.0f) break;               // fully faded out, no point mixing silence
+            }
+
+            // a seek (restart) from the UI may have landed meanwhile, it wins over our advance
+            bool seeked = !s.position.compare_exchange_strong(start, pos);
+
+            if (target <= 0.0f) s.target.store(0.0f, std::memory_order_relaxed); // reached the handover, stays faded out after a seek
+            if ((!seeked && pos >= s.length) || (s.phase <= 0.0f && target <= 0.0f)) s.state.store(DONE, std::memory_order_release);
+        }
+    }
+};
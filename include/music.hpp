@@ -4,6 +4,8 @@
 #include <vector>
 #include <string_view>
 #include <atomic>
+#include <algorithm>
+#include <stdexcept>
 
 #include <taglib/fileref.h>
 #include <taglib/mpegfile.h>
@@ -15,6 +17,60 @@
 
 namespace fs = std::filesystem;
 
+// whole file -> interleaved int16 as minimp3 hands it over, the caller frees info.buffer
+mp3dec_file_info_t decodeFile(const std::string& path) {
+    mp3dec_t mp3d;
+    mp3dec_init(&mp3d); 
+    mp3dec_file_info_t info;
+
+    int error = mp3dec_load(&mp3d, path.c_str(), &info, NULL, NULL);
+
+    if (error != 0) {
+        throw std::runtime_error("minimp3 error code: " + std::to_string(error));
+    }
+    return info;
+}
+
+// whole file -> mono floats in [-1, 1] (stereo is averaged), shared by Music and the background analysis jobs
+// sampleRate receives the file's rate
+std::vector<float> decodeMono(const std::string& path, int& sampleRate) {
+    mp3dec_file_info_t info = decodeFile(path);
+
+    sampleRate = info.hz;
+    std::vector<float> monoSamples;
+    monoSamples.reserve(info.samples / std::max(info.channels, 1));
+
+    if (info.channels == 2) { // [-1, 1] range for fft
+        for (size_t i = 0; i + 1 < info.samples; i += 2) {
+            float mono = (info.buffer[i] + info.buffer[i + 1]) / 65536.0f;
+            monoSamples.push_back(mono);
+        }
+    } else {
+        for (size_t i = 0; i < info.samples; i++) {
+            monoSamples.push_back(info.buffer[i] / 32768.0f);
+        }
+    }
+
+    free(info.buffer); 
+    return monoSamples;
+}
+
+// whole file -> one float buffer in [-1, 1] per channel, for measurements that need the channels apart (loudness)
+std::vector<std::vector<float>> decodeChannels(const std::string& path, int& sampleRate) {
+    mp3dec_file_info_t info = decodeFile(path);
+
+    sampleRate = info.hz;
+    size_t channels = (size_t)std::max(info.channels, 1);
+    std::vector<std::vector<float>> planar(channels, std::vector<float>(info.samples / channels));
+
+    for (size_t i = 0; i < info.samples / channels; i++) {
+        for (size_t c = 0; c < channels; c++) planar[c][i] = info.buffer[i * channels + c] / 32768.0f;
+    }
+
+    free(info.buffer);
+    return planar;
+}
+
 struct Music {
     std::vector<uint8_t> coverArt;
     std::vector<float> monoSamples;
@@ -23,48 +79,13 @@ struct Music {
     std::string album;
     std::string duration;
     std::string bitrate;
-    int channels;
-    int sample_rate;
+    int channels = 0;
+    int sample_rate = 0;
 
     Music() {}
     
     Music(const fs::path& path) {
-        { // have to make the MPEG go out of scope so it leaves the file and minimp3 can use it
-            TagLib::MPEG::File f(path.c_str());
-        
-            artist = "Unknown", title = "Unknown", album = "Unknown", duration = "0:00";
-
-            if (f.isValid()) {
-                // Text Metadata
-                if (f.tag()) {
-                    TagLib::Tag *tag = f.tag();
-                    title = tag->title().to8Bit(true);
-                    artist = tag->artist().to8Bit(true);
-                    album = tag->album().to8Bit(true);
-                }
-
-                // Duration logic
-                if (f.audioProperties()) {
-                    int sec = f.audioProperties()->lengthInSeconds();
-                    duration = std::to_string(sec / 60) + ":" + (sec % 60 < 10 ? "0" : "") + std::to_string(sec % 60);
-                    bitrate = std::to_string(f.audioProperties()->bitrate());                                               // kbps
-                    channels = f.audioProperties()->channels();                                                             // 1 = Mono, 2 = Stereo
-                    sample_rate = f.audioProperties()->sampleRate();
-                }
-
-                // 2. Extract Album Art (APIC Frame)
-                if (f.ID3v2Tag()) {
-                    auto frameList = f.ID3v2Tag()->frameList("APIC");
-                    if (!frameList.isEmpty()) {
-                        auto* frame = static_cast<TagLib::ID3v2::AttachedPictureFrame*>(frameList.front());
-                        TagLib::ByteVector pictureData = frame->picture();
-                        
-                        // Copy binary data into our vector
-                        coverArt.assign(pictureData.data(), pictureData.data() + pictureData.size());
-                    }
-                }
-            }
-        }
+        readTags(path); // the MPEG file is closed again before minimp3 opens it
         load(path.string());
     }
     
@@ -102,32 +123,61 @@ struct Music {
         return out;
     } 
 
-private:   
-    void load(const std::string& path) {
-        mp3dec_t mp3d;
-        mp3dec_init(&mp3d); 
-        mp3dec_file_info_t info;
+    // tags, audio properties and cover art only (no decoding), what an attached client needs to draw a track
+    void readTags(const fs::path& path) {
+        TagLib::MPEG::File f(path.c_str());
+    
+        artist = "Unknown", title = "Unknown", album = "Unknown", duration = "0:00";
+
+        if (f.isValid()) {
+            // Text Metadata
+            if (f.tag()) {
+                TagLib::Tag *tag = f.tag();
+                title = tag->title().to8Bit(true);
+                artist = tag->artist().to8Bit(true);
+                album = tag->album().to8Bit(true);
+            }
 
-        int error = mp3dec_load(&mp3d, path.c_str(), &info, NULL, NULL);
+            // Duration logic
+            if (f.audioProperties()) {
+                int sec = f.audioProperties()->lengthInSeconds();
+                duration = std::to_string(sec / 60) + ":" + (sec % 60 < 10 ? "0" : "") + std::to_string(sec % 60);
+                bitrate = std::to_string(f.audioProperties()->bitrate());                                               // kbps
+                channels = f.audioProperties()->channels();                                                             // 1 = Mono, 2 = Stereo
+                sample_rate = f.audioProperties()->sampleRate();
+            }
 
-        if (error != 0) {
-            throw std::runtime_error("minimp3 error code: " + std::to_string(error));
+            // 2. Extract Album Art (APIC Frame)
+            if (f.ID3v2Tag()) {
+                auto frameList = f.ID3v2Tag()->frameList("APIC");
+                if (!frameList.isEmpty()) {
+                    auto* frame = static_cast<TagLib::ID3v2::AttachedPictureFrame*>(frameList.front());
+                    TagLib::ByteVector pictureData = frame->picture();
+                    
+                    // Copy binary data into our vector
+                    coverArt.assign(pictureData.data(), pictureData.data() + pictureData.size());
+                }
+            }
         }
+    }
 
-        this->monoSamples.reserve(info.samples / channels);
+    // converts monoSamples to another rate (the device keeps the first track's rate so tracks can overlap)
+    // sample_rate keeps describing the file, it is what the UI shows
+    void resampleTo(int targetRate) {
+        if (targetRate <= 0 || targetRate == sample_rate || monoSamples.empty()) return;
 
-        if (channels == 2) { // [-1, 1] range for fft
-            for (size_t i = 0; i < info.samples; i += 2) {
-                float mono = (info.buffer[i] + info.buffer[i + 1]) / 65536.0f;
-                this->monoSamples.push_back(mono);
-            }
-        } else {
-            for (size_t i = 0; i < info.samples; i++) {
-                this->monoSamples.push_back(info.buffer[i] / 32768.0f);
-            }
-        }
+        ma_uint64 frames = ma_convert_frames(NULL, 0, ma_format_f32, 1, targetRate, monoSamples.data(), monoSamples.size(), ma_format_f32, 1, sample_rate);
+        std::vector<float> converted(frames);
 
-        free(info.buffer); 
+        frames = ma_convert_frames(converted.data(), frames, ma_format_f32, 1, targetRate, monoSamples.data(), monoSamples.size(), ma_format_f32, 1, sample_rate);
+        converted.resize(frames);
+
+        monoSamples = std::move(converted);
+    }
+
+private:   
+    void load(const std::string& path) {
+        this->monoSamples = decodeMono(path, this->sample_rate); // the decoder's rate is what the samples really are
     }
 };
 
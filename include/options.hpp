@@ -0,0 +1,127 @@
+# pragma once
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+#include <stdexcept>
+
+#include <realtime.hpp>
+#include <filterbank.hpp>
+#include <image.hpp>
+#include <loudness.hpp>
+#include <ipc.hpp>
+
+struct Options { // everything that can be tweaked from the command line
+    std::string musicDir = "../music";
+    rt::Config realtime;
+    Spectrum spectrum = Spectrum::LINEAR;
+    float crossfade = 0.0f;                 // seconds two tracks overlap on a track change, 0 = cut
+    size_t fftSize = 1024;                  // samples per visualizer frame, one of the sizes compiled in analyzer.hpp
+    PALETTE palette = TRUECOLOR;            // cover art colors
+    bool dither = false;
+    bool normalize = true;                  // per track loudness normalisation (playback gain + visualizer scale)
+    float targetLufs = loudness::DEFAULT_TARGET;
+    bool daemon = false;                    // headless engine serving --attach clients
+    bool attach = false;                    // UI of a running daemon
+    std::string socketPath;                 // empty = ipc::defaultSocketPath()
+
+    static void usage() {
+        std::cout << "Usage: AsciiAmp [music_dir] [options]\n"
+                  << "  --low-latency          real-time priority + locked sample buffers for the audio path\n"
+                  << "  --audio-cpus=0,1       pin the audio thread to these CPUs (implies --low-latency)\n"
+                  << "  --decode-cpus=2,3      pin the decode thread to these CPUs (implies --low-latency)\n"
+                  << "  --spectrum=MODE        visualizer band layout: linear (default), mel or cq (constant-Q)\n"
+                  << "  --fft-size=N           visualizer FFT size: 512, 1024 (default), 2048 or 4096\n"
+                  << "  --crossfade=SECONDS    equal power crossfade between tracks (default 0 = cut)\n"
+                  << "  --colors=MODE          cover art colors: truecolor (default), 256 or 16\n"
+                  << "  --dither               ordered dithering for --colors=256/16\n"
+                  << "  --normalize=LUFS       loudness every track is brought to (default -18, measured in the background)\n"
+                  << "  --no-normalize         play tracks as mastered\n"
+                  << "  --daemon               run the player headless, controlled by --attach clients\n"
+                  << "  --attach               show the UI of a running --daemon ([Q] detaches, [X] stops it)\n"
+                  << "  --socket=PATH          daemon socket (default $XDG_RUNTIME_DIR/asciiamp.sock)\n";
+    }
+};
+
+// "0,2,3" -> {0, 2, 3}
+inline std::vector<int> parseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string item;
+
+    while (std::getline(ss, item, ',')) {
+        if (item.empty()) continue;
+        cpus.push_back(std::stoi(item));
+    }
+    return cpus;
+}
+
+inline Options parseOptions(int argc, char* argv[]) {
+    Options opts;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&](const std::string& flag) { return arg.substr(flag.length()); }; // part after "--flag="
+
+        if (arg == "--low-latency") {
+            opts.realtime.enabled = true;
+        } else if (arg.rfind("--audio-cpus=", 0) == 0) {
+            opts.realtime.enabled = true;
+            opts.realtime.audioCpus = parseCpuList(value("--audio-cpus="));
+        } else if (arg.rfind("--decode-cpus=", 0) == 0) {
+            opts.realtime.enabled = true;
+            opts.realtime.decodeCpus = parseCpuList(value("--decode-cpus="));
+        } else if (arg.rfind("--spectrum=", 0) == 0) {
+            std::string mode = value("--spectrum=");
+            if (mode == "linear")   opts.spectrum = Spectrum::LINEAR;
+            else if (mode == "mel") opts.spectrum = Spectrum::MEL;
+            else if (mode == "cq")  opts.spectrum = Spectrum::CONSTANT_Q;
+            else throw std::invalid_argument("Unknown spectrum mode: " + mode);
+        } else if (arg.rfind("--fft-size=", 0) == 0) {
+            opts.fftSize = std::stoul(value("--fft-size="));
+            if (opts.fftSize != 512 && opts.fftSize != 1024 && opts.fftSize != 2048 && opts.fftSize != 4096) {
+                throw std::invalid_argument("Unsupported FFT size: " + std::to_string(opts.fftSize) + " (use 512, 1024, 2048 or 4096)");
+            }
+        } else if (arg.rfind("--crossfade=", 0) == 0) {
+            opts.crossfade = std::max(0.0f, std::stof(value("--crossfade=")));
+        } else if (arg.rfind("--colors=", 0) == 0) {
+            std::string mode = value("--colors=");
+            if (mode == "truecolor") opts.palette = TRUECOLOR;
+            else if (mode == "256")  opts.palette = XTERM_256;
+            else if (mode == "16")   opts.palette = ANSI_16;
+            else throw std::invalid_argument("Unknown color mode: " + mode);
+        } else if (arg == "--dither") {
+            opts.dither = true;
+        } else if (arg.rfind("--normalize=", 0) == 0) {
+            opts.normalize = true;
+            opts.targetLufs = std::clamp(std::stof(value("--normalize=")), -40.0f, 0.0f);
+        } else if (arg == "--no-normalize") {
+            opts.normalize = false;
+        } else if (arg == "--daemon") {
+            opts.daemon = true;
+        } else if (arg == "--attach") {
+            opts.attach = true;
+        } else if (arg.rfind("--socket=", 0) == 0) {
+            opts.socketPath = value("--socket=");
+        } else if (arg == "--help" || arg == "-h") {
+            Options::usage();
+            std::exit(0);
+        } else if (arg.rfind("--", 0) == 0) {
+            throw std::invalid_argument("Unknown option: " + arg);
+        } else {
+            opts.musicDir = arg; // first positional argument is the library directory
+        }
+    }
+
+    if (opts.daemon && opts.attach) throw std::invalid_argument("--daemon and --attach are separate processes, pick one");
+#ifdef _WIN32
+    if (opts.daemon || opts.attach) throw std::invalid_argument("--daemon/--attach need Unix domain sockets, not available on Windows builds");
+#else
+    if (opts.socketPath.empty()) opts.socketPath = ipc::defaultSocketPath();
+#endif
+
+    return opts;
+}
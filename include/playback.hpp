@@ -2,24 +2,125 @@
 
 #include <vector>
 #include <atomic>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <algorithm>
 
 #include <miniaudio.h>
 
 #include <music.hpp>
+#include <realtime.hpp>
+#include <mixer.hpp>
 
 struct Playback { // stores info for current music (a minimal reference to music object) it'll help reduce casting cost that the C libraries depend on (void* BS)
-    std::vector<float>* samples; // no copy of actual samples
-    std::atomic<size_t> playhead{0}; // read/write is atomic without mutex
+    std::vector<float>* samples = nullptr; // no copy of actual samples (track on screen, the mixer may still be fading out older ones)
+    Mixer mixer;                            // every source the callback plays, the current track is slot 'current'
+    std::atomic<int> current{-1};
     std::atomic<bool> pause{false};
     std::atomic<std::chrono::steady_clock::time_point> startTime;
     std::chrono::steady_clock::time_point pausedAt;
-    bool isPlaying = false;
+    std::atomic<bool> isPlaying{false};
+
+    const rt::Config* realtime = nullptr;   // set when low-latency mode is on, the callback promotes its own thread
+    std::atomic<int> audioStatus{-1};       // rt::Status of the callback thread, -1 until the first callback ran
+    std::atomic<uint64_t> periods{0};       // callbacks so far, waiting for it to move = waiting for the audio thread to see a change
+    std::atomic<float> preview{-1.0f};      // seek preview cursor on the progress bar as a fraction of the track, -1 = hidden
+
+    int upcoming = -1;                      // mixer slot of the queued next track (main thread only), -1 = nothing queued
+    std::vector<float>* upcomingSamples = nullptr;
+
+    size_t position() const  { return mixer.position(current.load()); }                    // playhead of the current track
+    size_t remaining() const { return mixer.length(current.load()) - std::min(position(), mixer.length(current.load())); }
+
+    // controls (keyboard, soak harness), main thread only: pausedAt isn't shared with anyone else
+    void restart() {
+        mixer.seek(current.load(), 0);
+        startTime.store(std::chrono::steady_clock::now());
+    }
+
+    // jumps to 'frame' of the current track, the progress clock follows
+    void seek(size_t frame, int sampleRate) {
+        auto now = std::chrono::steady_clock::now();
+        mixer.seek(current.load(), frame);
+        startTime.store(now - std::chrono::milliseconds(frame * 1000 / std::max(sampleRate, 1)));
+        pausedAt = now;                                     // seeking while paused: the pause starts counting again from here
+    }
+
+    // moves the preview cursor by 'columns' of a 'width' wide bar, the first move starts it at the playhead
+    void movePreview(int columns, int width) {
+        float at = preview.load();
+        if (at < 0.0f) at = (float)position() / std::max<size_t>(mixer.length(current.load()), 1);
+        preview.store(std::clamp(at + (float)columns / std::max(width, 1), 0.0f, 1.0f));
+    }
+
+    // Enter on the preview: seek there and hide the cursor (false when no preview was shown)
+    bool seekToPreview(int sampleRate) {
+        float at = preview.exchange(-1.0f);
+        if (at < 0.0f) return false;
+        seek((size_t)(at * mixer.length(current.load())), sampleRate);
+        return true;
+    }
+
+    void skip() { isPlaying = false; }                      // the loop owning the track moves on to the next one
+
+    void togglePause() {
+        bool paused = pause.load();
+        if (!paused) {
+            pausedAt = std::chrono::steady_clock::now();
+        } else { // the progress clock skips the time spent paused
+            auto pause_duration = std::chrono::steady_clock::now() - pausedAt;
+            startTime.store(startTime.load() + std::chrono::duration_cast<std::chrono::milliseconds>(pause_duration));
+        }
+        pause.store(!paused);
+    }
+
+    // hands obj to the mixer to start by itself at the current track's fade point (see Mixer::queue)
+    // false when it couldn't be queued, play() then starts it whenever it's called
+    bool queue(Music& obj, std::shared_ptr<void> owner, float gain = 1.0f) {
+        if (upcoming >= 0) return false;
+        upcoming = mixer.queue(obj.monoSamples.data(), obj.monoSamples.size(), current.load(), std::move(owner), gain);
+        if (upcoming >= 0) upcomingSamples = &(obj.monoSamples);
+        return upcoming >= 0;
+    }
+
+    void unqueue() { mixer.unqueue(upcoming); upcoming = -1; } // the queued track isn't next anymore
+
+    bool upcomingStarted() const { return upcoming >= 0 && mixer.started(upcoming); } // the mixer switched tracks on its own
+
+    // crossfades from the current track to obj, 'owner' keeps obj's samples alive for as long as the mixer reads them
+    // 'gain' is obj's loudness normalisation (1 = as mastered). When obj is the queued track it just becomes the
+    // current one (started right away if it's still waiting: a skip), anything else queued is dropped
+    void play(Music& obj, std::shared_ptr<void> owner, float gain = 1.0f) {
+        this->pause.store(false);                           // the callback has to run for fades/cuts to progress
+        this->preview.store(-1.0f);                         // a cursor placed on the old track means nothing on this one
+
+        if (upcoming >= 0 && upcomingSamples == &(obj.monoSamples)) {
+            if (!mixer.started(upcoming)) {
+                mixer.fadeOut(current.load());
+                mixer.startNow(upcoming);
+            }
+            this->samples = upcomingSamples;
+            this->current.store(upcoming);
+            this->upcoming = -1;
+            this->isPlaying = true;
+            return;
+        }
+        mixer.unqueue(upcoming);
+        upcoming = -1;
+
+        int previous = this->current.load();
+        mixer.fadeOut(previous);
+
+        int slot;
+        while ((slot = mixer.add(obj.monoSamples.data(), obj.monoSamples.size(), previous >= 0, owner, gain)) < 0) {
+            mixer.cutAllExcept(previous);                   // too many tracks still fading (fast skipping), drop them
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
 
-    void operator=(Music& obj) {
         this->samples = &(obj.monoSamples);
-        this->playhead.store(0);
+        this->current.store(slot);
         this->isPlaying = true;
-        this->pause.store(false);
     }
 };
 
@@ -27,26 +128,19 @@ struct Playback { // stores info for current music (a minimal reference to music
 void data_callback(ma_device* pDevice, void* pOutput, const void* pInput, ma_uint32 frameCount) {
     // 1. Cast the void pointer back to our C++ struct
     Playback* ctx = static_cast<Playback*>(pDevice->pUserData);
+    if (ctx) ctx->periods.fetch_add(1, std::memory_order_relaxed);
+
+    // first callback on a fresh device thread: ask for real-time priority once (never again in the hot path)
+    if (ctx && ctx->realtime && ctx->audioStatus.load(std::memory_order_relaxed) < 0) {
+        ctx->audioStatus.store(rt::promoteCurrentThread(rt::Role::AUDIO, ctx->realtime->audioCpus));
+    }
     
-    // Safety check: if no samples or not playing or paused, output silence
-    if (!ctx || !ctx->isPlaying || ctx->samples == nullptr || ctx->pause.load()) {
+    // Safety check: if paused output silence (positions stay where they are)
+    if (!ctx || ctx->pause.load()) {
         memset(pOutput, 0, frameCount * sizeof(float));
         return; 
     }
 
-    float* out = (float*)pOutput;
-    size_t totalSamples = ctx->samples->size();
-
-    // 2. Fill the buffer requested by the hardware (frameCount)
-    for (ma_uint32 i = 0; i < frameCount; ++i) {
-        size_t currentPos = ctx->playhead.load(); // Get current playhead
-
-        if (currentPos < totalSamples) {
-            out[i] = (*ctx->samples)[currentPos];
-            ctx->playhead.fetch_add(1); // Move playhead forward by 1
-        } else {
-            out[i] = 0.0f; // Song ended, fill with silence
-            ctx->isPlaying = false;
-        }
-    }
+    // 2. Fill the buffer requested by the hardware (frameCount), the main loop notices when the current track runs out
+    ctx->mixer.mix(static_cast<float*>(pOutput), frameCount);
 }
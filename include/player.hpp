@@ -0,0 +1,147 @@
+# pragma once
+
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <functional>
+#include <utility>
+#include <stdexcept>
+
+#include <miniaudio.h>
+
+#include <music.hpp>
+#include <playback.hpp>
+#include <analyzer.hpp>
+#include <options.hpp>
+#include <utils.hpp>
+
+// The per track playback loop, shared by the terminal UI (main), the daemon and the soak harness: loading (the next
+// track is preloaded and queued in the mixer), loudness, the device, natural track ends and what next/back/queue/quit
+// do to the play order. Front ends plug in through the hooks and drive it with the controls below from onFrame
+class Player {
+public:
+    // blocking load of library track 'index' at 'deviceRate' (0 = no device yet), also runs on the preload worker
+    using Loader = std::function<std::shared_ptr<LoadedTrack>(long index, int deviceRate)>;
+
+    Playback playback;                                  // pause/restart/seek go straight to it
+    SpectrumAnalyzer* analyzer = nullptr;               // rescaled to every track's loudness when set
+
+    std::function<void(long index, LoadedTrack& track)> onTrack;    // track started (screen, progress thread, clients)
+    std::function<void()> onFrame;                                  // once per loop: input, drawing, pacing (sleep/poll)
+    std::function<void()> onTrackEnd;                               // track left the screen (join the progress thread)
+
+private:
+    const Options& opts;
+    const long librarySize;
+    Loader load;
+    ma_context* context;                                // NULL = miniaudio's default backends
+
+    ma_device_config config;
+    ma_device device;                                   // opened once: later tracks are resampled to its rate and mixed in
+    bool deviceInitialized = false;
+    Preloader preloader;
+
+    long index = 0;                                     // library index of the current track
+    long picked = -1;                                   // queued by queue(), plays after the current one
+    bool prev = false, quitting = false;
+    std::shared_ptr<LoadedTrack> current;
+
+    long upcomingIndex() const { return (picked >= 0) ? picked : (index + 1) % librarySize; }
+
+    long nextIndex() {
+        if (prev) return (librarySize + index - 1) % librarySize;
+        if (picked >= 0) return std::exchange(picked, -1);
+        return (index + 1) % librarySize;
+    }
+
+    void openDevice(int sampleRate) { // the first track decides the device rate (changing it would mean reconfiguring the ma_device)
+        config.sampleRate = sampleRate;
+        if (ma_device_init(context, &config, &device) != MA_SUCCESS) throw std::runtime_error("Could not open the playback device");
+        deviceInitialized = true;
+
+        playback.mixer.fadeFrames = (size_t)(opts.crossfade * config.sampleRate);
+        ma_device_start(&device); // creates its own thread for music playback
+    }
+
+    // the next track is loaded ahead of the crossfade and queued in the mixer, which starts it on the exact frame
+    void preloadNext() {
+        if (playback.remaining() > playback.mixer.fadeFrames + PRELOAD_AHEAD.count() * config.sampleRate) return;
+
+        long upcoming = upcomingIndex();
+        int rate = (int)config.sampleRate;
+        preloader.start(upcoming, [load = load, upcoming, rate]() { return load(upcoming, rate); });
+
+        if (std::shared_ptr<LoadedTrack> next = preloader.ready(upcoming); next && playback.upcoming < 0) {
+            playback.queue(*next->music, next, opts.normalize ? next->gainTo(opts.targetLufs) : 1.0f);
+        }
+    }
+
+public:
+    Player(const Options& opts, long librarySize, Loader load, ma_context* context = NULL)
+        : opts(opts), librarySize(librarySize), load(std::move(load)), context(context) {
+        if (librarySize <= 0) throw std::invalid_argument("Nothing to play");
+
+        playback.realtime = opts.realtime.enabled ? &opts.realtime : nullptr;
+        config = ma_device_config_init(ma_device_type_playback);
+        config.playback.format   = ma_format_f32;   // since std::vector<float> for samples
+        config.playback.channels = 1;               // Mono (since every music was converted into mono)
+        config.dataCallback      = data_callback;   // The function we wrote in playback.hpp
+        config.pUserData         = &playback;       // the info it'll send to the data_callback function
+    }
+
+    Player(const Player&) = delete;
+    Player& operator=(const Player&) = delete;
+
+    // controls, from onFrame (the loop's thread)
+    void next()           { playback.skip(); }
+    void back()           { prev = true; playback.skip(); }
+    void queue(long pick) { picked = pick; playback.unqueue(); }   // takes the place of whatever was queued
+    void quit()           { quitting = true; playback.skip(); }
+
+    int sampleRate() const        { return (int)config.sampleRate; }
+    long trackIndex() const       { return index; }
+    const LoadedTrack& track() const { return *current; }
+
+    // plays from library index 'first' until quit(), closes the device on the way out
+    void run(long first = 0) {
+        index = first;
+
+        while (!quitting) {
+            current = preloader.take(index);                                // ready when we got here by playing on
+            if (!current) current = load(index, deviceInitialized ? (int)config.sampleRate : 0); // back, a late skip, first track
+            Music& music = *current->music;
+
+            // loudness comes from the cache only, a track the scanner hasn't reached yet plays as mastered
+            bool normalized = opts.normalize && current->measured;
+            if (analyzer && normalized) analyzer->setLoudness(current->loudness.integrated);
+            else if (analyzer) analyzer->resetLoudness();
+
+            playback.play(music, current, normalized ? current->gainTo(opts.targetLufs) : 1.0f); // fades the previous one out (or takes over the queued one)
+            prev = false;
+
+            if (!deviceInitialized) openDevice(music.sample_rate);
+            playback.startTime.store(std::chrono::steady_clock::now());
+            if (onTrack) onTrack(index, *current);
+
+            while (playback.isPlaying) {
+                if (onFrame) onFrame();
+                if (quitting) break;
+
+                preloadNext();
+                if (playback.upcomingStarted()) playback.isPlaying = false;   // the mixer moved on, catch up
+                else if (playback.upcoming < 0 && playback.remaining() <= playback.mixer.fadeFrames) playback.isPlaying = false; // nothing queued in time: start it by hand
+                playback.mixer.reclaim();       // release tracks that finished fading out
+            }
+
+            if (quitting && deviceInitialized) {                            // audio off before the front end tears down
+                quitPlayback(playback, &device);
+                deviceInitialized = false;
+            }
+            if (onTrackEnd) onTrackEnd();
+            if (!quitting) index = nextIndex();
+        }
+        current.reset();
+    }
+
+    ~Player() { if (deviceInitialized) quitPlayback(playback, &device); } // run() threw
+};
@@ -0,0 +1,159 @@
+# pragma once
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <cstdint>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX // windows.h min/max macros break std::min/std::max
+    #endif
+    #include <windows.h>
+#else
+    #include <pthread.h>
+    #include <sched.h>
+    #include <sys/mman.h>
+#endif
+
+// Opt-in low-latency mode: real-time scheduling, CPU pinning and locked sample buffers.
+// Everything here is best effort, every call reports what it could not do so the UI can tell the user
+// (an unprivileged user usually gets PRIORITY_DENIED and LOCK_DENIED on Linux)
+namespace rt {
+
+struct Config {
+    bool enabled = false;
+    std::vector<int> audioCpus;     // empty = let the scheduler decide
+    std::vector<int> decodeCpus;
+};
+
+enum class Role : uint8_t {
+    AUDIO,                                                                  // miniaudio's callback thread, highest priority we can get
+    DECODE                                                                  // decode/analysis workers, real-time but below audio
+};
+
+enum Status : uint8_t {
+    OK              = 0,
+    PRIORITY_DENIED = 1 << 0,
+    AFFINITY_FAILED = 1 << 1,
+    LOCK_DENIED     = 1 << 2,
+    UNSUPPORTED     = 1 << 3                                                // platform has no API for what was asked
+};
+
+// restricts the calling thread to 'cpus' (empty = leave it alone), scheduling untouched, returns a Status bitmask
+inline uint8_t pinCurrentThread(const std::vector<int>& cpus) {
+    if (cpus.empty()) return OK;
+
+#ifdef _WIN32
+    DWORD_PTR mask = 0;
+    for (int cpu : cpus) if (cpu >= 0 && cpu < (int)(sizeof(DWORD_PTR) * 8)) mask |= (DWORD_PTR(1) << cpu);
+    if (mask == 0 || !SetThreadAffinityMask(GetCurrentThread(), mask)) return AFFINITY_FAILED;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+    if (CPU_COUNT(&set) == 0 || pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) return AFFINITY_FAILED;
+#else
+    return UNSUPPORTED; // macOS only has affinity "hints", nothing we can pin with
+#endif
+    return OK;
+}
+
+// applies priority + affinity to the calling thread, returns a Status bitmask
+inline uint8_t promoteCurrentThread(Role role, const std::vector<int>& cpus) {
+    uint8_t status = OK;
+
+#ifdef _WIN32
+    int priority = (role == Role::AUDIO) ? THREAD_PRIORITY_TIME_CRITICAL : THREAD_PRIORITY_HIGHEST;
+    if (!SetThreadPriority(GetCurrentThread(), priority)) status |= PRIORITY_DENIED;
+#else
+    int max = sched_get_priority_max(SCHED_FIFO);
+    int min = sched_get_priority_min(SCHED_FIFO);
+
+    sched_param param{};
+    param.sched_priority = (role == Role::AUDIO) ? max - 1 : min + (max - min) / 2; // leave the very top for the kernel's own threads
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0) status |= PRIORITY_DENIED;
+#endif
+
+    return status | pinCurrentThread(cpus);
+}
+
+// where batch work (the loudness scanner) may run in low-latency mode: never real-time, on the decode CPUs, or at
+// least off the audio ones when only those were given. Empty = anywhere (nothing pinned, or audio took every CPU)
+inline std::vector<int> backgroundCpus(const Config& config) {
+    std::vector<int> cpus;
+    if (!config.enabled) return cpus;
+    if (!config.decodeCpus.empty()) return config.decodeCpus;
+    if (config.audioCpus.empty()) return cpus;
+
+    for (int cpu = 0; cpu < (int)std::thread::hardware_concurrency(); cpu++) {
+        if (std::find(config.audioCpus.begin(), config.audioCpus.end(), cpu) == config.audioCpus.end()) cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+// keeps a buffer resident in RAM (no page faults inside the audio callback), unlocks on destruction
+class MemoryLock {
+    const void* ptr = nullptr;
+    size_t bytes = 0;
+
+public:
+    MemoryLock() = default;
+    MemoryLock(const MemoryLock&) = delete;
+    MemoryLock& operator=(const MemoryLock&) = delete;
+
+    ~MemoryLock() { unlock(); }
+
+    uint8_t lock(const void* data, size_t size) {
+        unlock();
+        if (data == nullptr || size == 0) return OK;
+
+#ifdef _WIN32
+        bool locked = VirtualLock(const_cast<void*>(data), size);
+#else
+        bool locked = mlock(data, size) == 0;
+#endif
+        if (!locked) return LOCK_DENIED;
+
+        ptr = data;
+        bytes = size;
+        return OK;
+    }
+
+    void unlock() {
+        if (ptr == nullptr) return;
+#ifdef _WIN32
+        VirtualUnlock(const_cast<void*>(ptr), bytes);
+#else
+        munlock(ptr, bytes);
+#endif
+        ptr = nullptr;
+        bytes = 0;
+    }
+};
+
+// human readable explanation of a Status bitmask, "OK" when everything was granted
+inline std::string describe(uint8_t status) {
+    if (status == OK) return "OK";
+
+    std::string text;
+    auto append = [&](const char* reason) {
+        if (!text.empty()) text += ", ";
+        text += reason;
+    };
+
+#ifdef _WIN32
+    if (status & PRIORITY_DENIED) append("priority denied");
+    if (status & LOCK_DENIED)     append("memory lock denied (working set too small)");
+#else
+    if (status & PRIORITY_DENIED) append("RT priority denied (needs CAP_SYS_NICE or ulimit -r)");
+    if (status & LOCK_DENIED)     append("mlock denied (raise ulimit -l)");
+#endif
+    if (status & AFFINITY_FAILED) append("CPU pinning failed (check the CPU list)");
+    if (status & UNSUPPORTED)     append("CPU pinning unsupported on this platform");
+
+    return text;
+}
+
+}
@@ -0,0 +1,76 @@
+# pragma once
+
+#include <cstddef>
+#include <cfloat>
+#include <algorithm>
+
+// SSE is baseline on every x86-64 target we build for (MinGW/GCC/Clang/MSVC), anything else takes the scalar path
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    #include <xmmintrin.h>
+    #define ASCIIAMP_SSE 1
+#endif
+
+// small vectorized kernels shared by the analysis code (4 floats per step, scalar tail)
+namespace simd {
+
+#ifdef ASCIIAMP_SSE
+inline float horizontalMin(__m128 v) { alignas(16) float lanes[4]; _mm_store_ps(lanes, v); return std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3])); }
+inline float horizontalMax(__m128 v) { alignas(16) float lanes[4]; _mm_store_ps(lanes, v); return std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3])); }
+inline float horizontalSum(__m128 v) { alignas(16) float lanes[4]; _mm_store_ps(lanes, v); return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]); }
+#endif
+
+// min, max and sum of squares of data[0, n) in one pass (all 0 for an empty range)
+inline void minMaxSumSq(const float* data, size_t n, float& outMin, float& outMax, float& outSumSq) {
+    if (n == 0) { outMin = outMax = outSumSq = 0.0f; return; }
+
+    float mn = FLT_MAX, mx = -FLT_MAX, sq = 0.0f;
+    size_t i = 0;
+
+#ifdef ASCIIAMP_SSE
+    if (n >= 4) {
+        __m128 vmin = _mm_loadu_ps(data);
+        __m128 vmax = vmin;
+        __m128 vsq  = _mm_mul_ps(vmin, vmin);
+
+        for (i = 4; i + 4 <= n; i += 4) {
+            __m128 v = _mm_loadu_ps(data + i);
+            vmin = _mm_min_ps(vmin, v);
+            vmax = _mm_max_ps(vmax, v);
+            vsq  = _mm_add_ps(vsq, _mm_mul_ps(v, v));
+        }
+
+        mn = horizontalMin(vmin);
+        mx = horizontalMax(vmax);
+        sq = horizontalSum(vsq);
+    }
+#endif
+
+    for (; i < n; i++) { // scalar tail (or everything without SSE)
+        mn = std::min(mn, data[i]);
+        mx = std::max(mx, data[i]);
+        sq += data[i] * data[i];
+    }
+
+    outMin = mn;
+    outMax = mx;
+    outSumSq = sq;
+}
+
+// out[i] += in[i] * (gain + gainStep * i), the per sample linear gain ramp used by the mixer's fades
+inline void mixRamp(float* out, const float* in, size_t n, float gain, float gainStep) {
+    size_t i = 0;
+
+#ifdef ASCIIAMP_SSE
+    __m128 g  = _mm_add_ps(_mm_set1_ps(gain), _mm_mul_ps(_mm_set1_ps(gainStep), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f)));
+    __m128 dg = _mm_set1_ps(gainStep * 4.0f);
+
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(_mm_loadu_ps(in + i), g)));
+        g = _mm_add_ps(g, dg);
+    }
+#endif
+
+    for (; i < n; i++) out[i] += in[i] * (gain + gainStep * i);
+}
+
+}
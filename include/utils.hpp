@@ -1,13 +1,26 @@
+# pragma once
+
 #include <image.hpp>
 #include <music.hpp>
 #include <playback.hpp>
+#include <realtime.hpp>
+#include <waveform.hpp>
+#include <cache.hpp>
+#include <analyzer.hpp>
+#include <compositor.hpp>
+#include <library.hpp>
+#include <loudness.hpp>
 
 #include <echo.hpp>
-#include <kiss_fft.h>
 
 #include <vector>
 #include <chrono>
 #include <thread>
+#include <memory>
+#include <exception>
+#include <future>
+#include <functional>
+#include <algorithm>
 
 
 #ifdef _WIN32
@@ -66,8 +79,7 @@ inline extern constexpr char BOLD[] = "\033[1m";
 inline extern constexpr char DIM_BOLD[] = "\033[2m";
 inline extern constexpr char ITALIC[] = "\033[3m";
 inline extern constexpr char UNDERLINE[] = "\033[4m";
-
-constexpr float REFERENCE = 40.0f; // what's considered loud 
+inline extern constexpr char NORMAL_INTENSITY[] = "\033[22m"; // ends BOLD/DIM but keeps the color
 
 template <typename T>
 T random_gen(const T min, const T max) {
@@ -78,17 +90,32 @@ T random_gen(const T min, const T max) {
     return dist(gen);
 } 
 
-void printCover(const Music& music) { // wrapping in function release memory asap
+// image work happens on the caller, only the drawing is handed to the compositor
+void printCover(const Music& music, Compositor::Queue& ui, PALETTE palette = TRUECOLOR, bool dither = false) { // wrapping in function release memory asap
+    int window_x = 1, window_y = 1;
     int window_width = IMAGE_W, window_height = IMAGE_H; // as height is double than width in terminal
-    echo::Window window(1, 1, window_width, window_height, "BOX");
+    auto window = std::make_shared<echo::Window>(window_x, window_y, window_width, window_height, "BOX");
 
     Image img(music.coverArt);
-    img.downScale(window.get_w(), window.get_h(), SAMPLE::BOX);
+    img.downScale(window->get_w(), window->get_h(), SAMPLE::BOX);
     
-    auto [characters, colors] = img.toAscii();
+    if (palette == TRUECOLOR) {
+        auto [characters, colors] = img.toAscii();
+
+        Compositor::submit(ui, [window, characters = std::move(characters), colors = std::move(colors)]() {
+            echo::Visualizer::Plots::draw_frame(*window, characters, colors);
+            window->render();
+        });
+        return;
+    }
 
-    echo::Visualizer::Plots::draw_frame(window, characters, colors);
-    window.render();
+    // palette rows already carry their (coalesced) escapes, echo only draws the border and we place the rows inside it
+    Compositor::submit(ui, [window, window_x, window_y, rows = img.toAnsi(palette, dither)]() {
+        window->render();
+        for (size_t r = 0; r < rows.size(); r++) {
+            std::cout << "\033[" << (window_y + 1 + r) << ";" << (window_x + 1) << "H" << rows[r];
+        }
+    });
 } 
 
 void printCover(const std::string& path = "C:/Users/shadows box/Downloads/2.jpeg") { // wrapping in function release memory asap
@@ -139,243 +166,402 @@ int getPadding(const std::string& str, int window_w) {
     return padding;
 }
 
-std::vector<float> getFFTwindow(const Playback& playbackInfo, size_t window_size = 1024) { // window to send to kissfft 
-    std::vector<float> window(window_size, 0.0f);
-    size_t currPos = playbackInfo.playhead.load();
+int64_t timestampToSeconds(const std::string& timestamp) {
+    int minutes = 0;
+    int seconds = 0;
+    char colon;
 
-    for (size_t i = 0; i < window_size; i++) {
-        size_t idx = currPos + i;
-        if (idx < playbackInfo.samples->size()) { window[i] = playbackInfo.samples->at(idx); }
-        else break;
+    std::stringstream ss(timestamp);
+    
+    // Parse the string (Expected format "MM:SS")
+    if (ss >> minutes >> colon >> seconds) {
+        return (std::chrono::minutes(minutes) + std::chrono::seconds(seconds)).count();
     }
 
-    return window;
+    // Return 0 if parsing fails
+    return std::chrono::seconds(0).count();
 }
 
-// NOTE: cfg is a pointer hence by value
-// also returns mirrored maxBars (calculates fft for maxBars / 2) then mirrors it
-std::vector<int> getNbars(const Playback& playbackInfo, kiss_fft_cfg cfg, int maxBars, int maxHeight) {
-    std::vector<float> window = getFFTwindow(playbackInfo);
-    size_t nfft = window.size();
-
-    // setup input and output (cpx is a struct with .r and .i for real and imaginary part respectively)
-    std::vector<kiss_fft_cpx> in(nfft);
-    std::vector<kiss_fft_cpx> out(nfft);
+// pyramid of the track, read from the cache when this exact file was played before
+WaveformPyramid loadWaveform(const fs::path& track, const std::vector<float>& monoSamples) {
+    WaveformPyramid waveform;
+    fs::path path = cache::pathFor(track, ".wave");
+    uint64_t key = cache::keyFor(track);
 
-    for (int i = 0; i < nfft; ++i) {
-        in[i].r = window[i];
-        in[i].i = 0.0f; // Audio samples have no imaginary part
+    if (!waveform.load(path, key, monoSamples.size())) {
+        waveform.build(monoSamples);
+        waveform.save(path, key);
     }
+    return waveform;
+}
 
-    kiss_fft(cfg, in.data(), out.data());
-
-    // Calculate Magnitudes
-    // The result is symmetrical, so we only need the first half (0 to nfft/2)
-    std::vector<float> magnitudes;
-    magnitudes.reserve(nfft / 2);
-
-    for (int i = 0; i < nfft / 2; ++i) {
-        // Pythagorean theorem to get the "loudness" of this frequency
-        float mag = std::sqrt(out[i].r * out[i].r + out[i].i * out[i].i);
-        magnitudes.push_back(mag);
-    }
-
-    // Now we can convert the magnitudes to bars
-    // for one side we calculate
-
-    int half_size = (maxBars & 1) ? (maxBars / 2) + 1 : maxBars / 2;
-    std::vector<int> bars(half_size, 0);
-    int numBins = (int)magnitudes.size();
-
-    for (int i = 0; i < half_size; ++i) {
-        // 1. Logarithmic Binning (Frequency Spacing)
-        float startRel = (float)i / half_size;
-        float endRel = (float)(i + 1) / half_size;
-        
-        int startBin = (int)(pow(startRel, 1.5f) * numBins);
-        int endBin = (int)(pow(endRel, 1.5f) * numBins);
-        if (endBin <= startBin) endBin = startBin + 1;
+// one char per column, taller glyph = louder part of the track ('_' keeps silent parts visible)
+std::string waveformShape(const WaveformPyramid& waveform, int width) {
+    static constexpr char RAMP[] = "_.:-=+*#%@";
+    constexpr int levels = sizeof(RAMP) - 1;
 
-        float sum = 0;
-        for (int j = startBin; j < endBin && j < numBins; ++j) {
-            sum += magnitudes[j];
-        }
-        float avg = sum / (endBin - startBin);
+    if (waveform.empty()) return std::string(width, '-');
 
-        float intensity = 0;
-        if (avg > 0) {
-            // 1. Normalize: Get a ratio between 0.0 and 1.0
-            float ratio = avg / REFERENCE;
-            
-            // 2. Log Scale: This squashes the range so it's not "all or nothing"
-            // Use log2 or a smaller multiplier than 20 to keep it chill
-            intensity = 20 * log10(1.0f + ratio); 
-        }
-
-        // 3. Scale to maxHeight
-        // This ensures 'intensity' acts as a percentage (0.0 to 1.0) of your height
-        int h = (int)(intensity * maxHeight) + 1; // we scaled everything by +1
+    float peak = waveform.peak();
+    std::string shape;
+    shape.reserve(width);
 
-        bars[i] = std::clamp(h, 0, maxHeight);
+    for (const WaveformPyramid::Envelope& column : waveform.overview(width)) {
+        float amplitude = (peak > 0.0f) ? std::max(std::fabs(column.min), std::fabs(column.max)) / peak : 0.0f;
+        shape.push_back(RAMP[std::clamp((int)(amplitude * levels), 0, levels - 1)]);
     }
+    return shape;
+}
 
-    std::vector<int> fullBars;
-    fullBars.reserve(maxBars);
-
-    for (int i = half_size - 1; i >= (maxBars & 1) ; i--) {
-        fullBars.push_back(bars[i]);
-    }
+inline constexpr std::chrono::milliseconds PROGRESS_POLL{50}; // how often the progress thread checks in (redraws only when the second changes)
 
-    // the remaining half
-    fullBars.insert(fullBars.end(), bars.begin(), bars.end());
-    return fullBars;
+std::string clockText(long long seconds) {
+    char text[16];
+    snprintf(text, sizeof(text), "%d:%02d", (int)(seconds / 60), (int)(seconds % 60));
+    return text;
 }
 
-int64_t timestampToSeconds(const std::string& timestamp) {
-    int minutes = 0;
-    int seconds = 0;
-    char colon;
-
-    std::stringstream ss(timestamp);
-    
-    // Parse the string (Expected format "MM:SS")
-    if (ss >> minutes >> colon >> seconds) {
-        return (std::chrono::minutes(minutes) + std::chrono::seconds(seconds)).count();
+// what lies under the seek preview cursor: its time and the envelope of that column, read from the pyramid
+std::string previewText(const WaveformPyramid& waveform, float at, int column, int bar_width, int total_duration) {
+    std::string text = "Seek to " + clockText((long long)(at * total_duration));
+    if (!waveform.empty()) {
+        size_t begin = waveform.samples() * column / bar_width;
+        size_t end = waveform.samples() * (column + 1) / bar_width;
+        WaveformPyramid::Envelope e = waveform.query(begin, end);
+
+        auto dB = [](float v) { return 20.0f * std::log10(std::max(v, 1e-5f)); };
+        char levels[64];
+        snprintf(levels, sizeof(levels), " | peak %.1f dB | rms %.1f dB", dB(std::max(std::fabs(e.min), std::fabs(e.max))), dB(e.rms));
+        text += levels;
     }
-
-    // Return 0 if parsing fails
-    return std::chrono::seconds(0).count();
+    return text + "    [Enter] Jump";
 }
 
-void runTimestamp(echo::Window& playback, const Music& music, const Playback& playbackInfo, int playback_width, int bar_width, int starting_col) {
+void runTimestamp(echo::Window& playback, Compositor::Queue& ui, const Music& music, const Playback& playbackInfo, const WaveformPyramid& waveform, int playback_width, int bar_width, int starting_col) {
     namespace tv = echo;
     namespace Viz = echo::Visualizer::Plots;
     
     int total_duration = timestampToSeconds(music.duration);
+    std::string shape = waveformShape(waveform, bar_width); // the overview never changes during the track
+    long long shown = -1;                                    // second currently on screen
+    int shownCursor = -1;                                    // preview column currently on screen
+
+    // short naps instead of one 1s sleep: a track change / quit never waits on this thread for long
+    for (; playbackInfo.isPlaying; std::this_thread::sleep_for(PROGRESS_POLL)) { 
+        float at = playbackInfo.preview.load();
+        int cursor = (at >= 0.0f) ? std::clamp((int)(at * bar_width), 0, bar_width - 1) : -1;
+        bool paused = playbackInfo.pause.load();
+        if (paused && shown >= 0 && cursor == shownCursor) continue; // first draw goes through, e.g. attaching to a paused daemon
 
-    while (playbackInfo.isPlaying) { 
-        if (playbackInfo.pause.load()) continue;
         auto now = std::chrono::steady_clock::now();
         auto total_seconds = std::chrono::duration_cast<std::chrono::seconds>(now - playbackInfo.startTime.load()).count();
+        if (paused && shown >= 0) total_seconds = shown;    // the clock stands still, only the cursor moved
         if (total_seconds > total_duration) total_seconds = total_duration;
+        if (total_seconds == shown && cursor == shownCursor) continue;
+        shown = total_seconds;
+        shownCursor = cursor;
 
         // 1. Fixed-width Time Formatting
-        char current_time[16];
-        snprintf(current_time, sizeof(current_time), "%d:%02d", (int)(total_seconds / 60), (int)(total_seconds % 60));
+        std::string current_time = clockText(total_seconds);
         
         // 2. Progress Bar Math
         int played_amount = (total_duration > 0) ? (int)(((float)total_seconds / total_duration) * bar_width) : 0;
 
-        std::string bar = "[" + std::string(played_amount, '#') + std::string(bar_width - played_amount, '-') + "]";
-        std::string progress_line = std::string(current_time) + bar + music.duration;
+        // played part bright, the rest dimmed, '|' marks the seek preview
+        std::string marked = shape;
+        if (cursor >= 0 && cursor < (int)marked.size()) marked[cursor] = '|';
+        std::string bar = "[" + marked.substr(0, played_amount) + DIM_BOLD + marked.substr(played_amount) + NORMAL_INTENSITY + BOLD + "]";
+        std::string progress_line = current_time + bar + music.duration;
 
 
         // 3. Dynamic Technical Status Line
-        // Uses the new bitrate, sample_rate, and channels data
+        // Uses the new bitrate, sample_rate, and channels data (the preview readout takes its place while the cursor is up)
         std::string chan_text = (music.channels == 2) ? "Stereo" : (music.channels == 1 ? "Mono" : "Multi");
         char tech_buf[128];
         snprintf(tech_buf, sizeof(tech_buf), "%s kbps | %.1f kHz | %s", 
                  music.bitrate.c_str(), music.sample_rate / 1000.0f, chan_text.c_str());
         
-        std::string tech_status = tech_buf;
+        std::string tech_status = (cursor >= 0) ? previewText(waveform, at, cursor, bar_width, total_duration) : std::string(tech_buf);
+        tech_status.resize(std::max<size_t>(tech_status.size(), playback_width), ' '); // covers a longer line drawn before
         int tech_padding = (playback_width - tech_status.length()) / 2;
 
         // 4. Keyboard Shortcuts Legend
-        std::string legend = " [P] Pause/Play    [B] Back    [Q] Quit    [<-/->] Restart/Next";
-        
-        // --- RENDERING ---
-        // Top Row: Real-time File Stats
-        playback.print(playback.get_h() / 2 - 2, starting_col, BOLD + tech_status + NORMAL);
+        std::string legend = " [P] Pause/Play    [B] Back    [Q] Quit    [<-/->] Restart/Next    [,/.] Seek    [/] Search";
         
-        // Middle Row: Blue Progress Bar
-        playback.print(playback.get_h() / 2, starting_col, BOLD + progress_line + NORMAL, tv::COLOR(tv::COLOR::BLUE));
+        // --- RENDERING --- (on the compositor thread)
+        Compositor::submit(ui, [&playback, starting_col, tech_status, progress_line, legend]() {
+            // Top Row: Real-time File Stats
+            playback.print(playback.get_h() / 2 - 2, starting_col, BOLD + tech_status + NORMAL);
+            
+            // Middle Row: Blue Progress Bar
+            playback.print(playback.get_h() / 2, starting_col, BOLD + progress_line + NORMAL, tv::COLOR(tv::COLOR::BLUE));
 
-        // Bottom Row: Controls
-        playback.print(playback.get_h() / 2 + 2, getPadding(legend, playback.get_w()), BOLD + legend + NORMAL);
+            // Bottom Row: Controls
+            playback.print(playback.get_h() / 2 + 2, getPadding(legend, playback.get_w()), BOLD + legend + NORMAL);
 
-        playback.render(false);
-        std::this_thread::sleep_for(1s);
+            playback.render(false);
+        });
     }
 }
 
-inline void screenInit(const Music& music, echo::Window& title) { // display everthing at the start of the music
+inline void screenInit(const Music& music, echo::Window& title, Compositor::Queue& ui, PALETTE palette = TRUECOLOR, bool dither = false) { // display everthing at the start of the music
     // print and setup everything else
-    printCover(music);
-    title.clean_buffer();
-    title.print(0, getPadding(music.title, title.get_w()), format(toUpper(music.title), BOLD));
-    title.print(1, getPadding(music.artist, title.get_w()), format(toUpper(music.artist), UNDERLINE));
-    title.print(2, getPadding(music.album, title.get_w()), format(toUpper(music.album)));
-    title.render(true); 
+    printCover(music, ui, palette, dither);
+    Compositor::submit(ui, [&title, t = music.title, ar = music.artist, al = music.album]() {
+        title.clean_buffer();
+        title.print(0, getPadding(t, title.get_w()), format(toUpper(t), BOLD));
+        title.print(1, getPadding(ar, title.get_w()), format(toUpper(ar), UNDERLINE));
+        title.print(2, getPadding(al, title.get_w()), format(toUpper(al)));
+        title.render(true); 
+    });
 }
 
-// takes action based on keyboard input and return the key pressed (which is used for some controls in main)
-char controller(Playback& playbackInfo, ma_device *pDevice) { 
-    if (kbhit()) {
-        int code = _getch();
-
-        // Cross-platform Arrow Key Handling
-        // Windows: Starts with 0 or 224
-        // Linux: Starts with Escape (27), then '[', then A, B, C, or D
-        #ifdef _WIN32
-        if (code == 0 || code == 224) {
-            int arrow = _getch();
-            switch (arrow) {
-                case 72: return 'U'; // UP
-                case 80: return 'D'; // DOWN
-                case 75: 
-                    playbackInfo.playhead.store(0);
-                    playbackInfo.startTime.store(std::chrono::steady_clock::now());
-                    break; 
-                case 77: 
-                    playbackInfo.isPlaying = false; // Skip to next song 
-                    break;
-            }
+// decodes on a short-lived worker so low-latency mode can prioritise/pin decoding away from the UI thread
+std::unique_ptr<Music> loadMusic(const fs::path& path, const rt::Config& realtime, uint8_t& decodeStatus) {
+    decodeStatus = rt::OK;
+    if (!realtime.enabled) return std::make_unique<Music>(path);
+
+    std::unique_ptr<Music> music;
+    std::exception_ptr error;
+
+    std::thread decoder([&]() {
+        decodeStatus = rt::promoteCurrentThread(rt::Role::DECODE, realtime.decodeCpus);
+        try { music = std::make_unique<Music>(path); }
+        catch (...) { error = std::current_exception(); }
+    });
+    decoder.join();
+
+    if (error) std::rethrow_exception(error);
+    return music;
+}
+
+// everything that must outlive the loop iteration while the mixer may still be fading the track out
+struct LoadedTrack {
+    std::unique_ptr<Music> music;
+    rt::MemoryLock samplesLock;             // keeps the PCM resident while the mixer reads it (low-latency mode)
+    uint8_t decodeStatus = rt::OK;
+    uint8_t lockStatus = rt::OK;
+    WaveformPyramid waveform;               // overview for the progress bar (and the cache attached clients read)
+    Loudness loudness;                      // from the cache, only valid when 'measured'
+    bool measured = false;
+
+    float gainTo(float targetLufs) const { return measured ? loudness.gainTo(targetLufs) : 1.0f; } // unity until scanned
+};
+
+// decode + convert to the device rate (0 = no device yet, keep the file's rate) + lock, then everything else the
+// track needs before it can start: waveform and cached loudness. Slow, the playback loop preloads it (see Preloader)
+std::shared_ptr<LoadedTrack> loadTrack(const fs::path& path, const rt::Config& realtime, int deviceRate) {
+    auto track = std::make_shared<LoadedTrack>();
+    track->music = loadMusic(path, realtime, track->decodeStatus);
+    track->music->resampleTo(deviceRate);
+
+    if (realtime.enabled) {
+        const std::vector<float>& pcm = track->music->monoSamples;
+        track->lockStatus = track->samplesLock.lock(pcm.data(), pcm.size() * sizeof(float));
+    }
+
+    track->waveform = loadWaveform(path, track->music->monoSamples);
+    track->measured = loudness::cached(path, track->loudness); // a track the scanner hasn't reached yet plays as mastered
+    return track;
+}
+
+inline constexpr std::chrono::seconds PRELOAD_AHEAD{20}; // the next track is loaded this long before its crossfade starts
+
+// loads the track that plays next on a worker while the current one still plays, so reaching the end of a track
+// (or skipping close to it) costs no decode time. One track at a time, a preload nobody wants is left to finish
+// on its own and dropped
+class Preloader {
+    using Result = std::future<std::shared_ptr<LoadedTrack>>;
+
+    long index = -1;                        // library index being / been loaded
+    Result pending;
+    std::shared_ptr<LoadedTrack> loaded;
+    std::vector<Result> abandoned;          // unwanted loads still running (a future from std::async joins when destroyed)
+
+    void drop() {
+        if (pending.valid()) abandoned.push_back(std::move(pending));
+        index = -1;
+        loaded.reset();
+    }
+
+public:
+    // starts 'load' (usually loadTrack) for 'trackIndex' unless that one is already under way
+    void start(long trackIndex, std::function<std::shared_ptr<LoadedTrack>()> load) {
+        abandoned.erase(std::remove_if(abandoned.begin(), abandoned.end(), [](const Result& r) {
+            return r.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        }), abandoned.end());
+
+        if (trackIndex == index) return;
+        drop();
+        index = trackIndex;
+        pending = std::async(std::launch::async, std::move(load));
+    }
+
+    // the track once it's loaded, nullptr while it isn't (never blocks), rethrows what the load threw
+    std::shared_ptr<LoadedTrack> ready(long trackIndex) {
+        if (trackIndex != index) return nullptr;
+        if (pending.valid() && pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready) loaded = pending.get();
+        return loaded;
+    }
+
+    // hands 'trackIndex' over (waiting for it when it's still loading), nullptr when something else was preloaded
+    std::shared_ptr<LoadedTrack> take(long trackIndex) {
+        if (trackIndex != index) { drop(); return nullptr; }
+        if (pending.valid()) loaded = pending.get();
+
+        std::shared_ptr<LoadedTrack> track = std::move(loaded);
+        drop();
+        return track;
+    }
+};
+
+// one line summary of what low-latency mode actually got, shown under the track info
+std::string realtimeReport(uint8_t audioStatus, uint8_t decodeStatus, uint8_t lockStatus) {
+    if ((audioStatus | decodeStatus | lockStatus) == rt::OK) return "Low-latency: active";
+
+    std::string report = "Low-latency: ";
+    if (audioStatus != rt::OK)  report += "audio " + rt::describe(audioStatus) + " | ";
+    if (decodeStatus != rt::OK) report += "decode " + rt::describe(decodeStatus) + " | ";
+    if (lockStatus != rt::OK)   report += "buffers " + rt::describe(lockStatus) + " | ";
+
+    return report.substr(0, report.length() - 3); // drop trailing separator
+}
+
+// stops the audio for good, the caller still joins the progress thread (which notices within PROGRESS_POLL)
+void quitPlayback(Playback& playbackInfo, ma_device* pDevice) {
+    playbackInfo.skip();
+    ma_device_stop(pDevice);
+    ma_device_uninit(pDevice);
+}
+
+// arrows come in as multi byte sequences that differ per platform, readKey folds them into these
+// (Enter/Backspace differ per platform too, Escape alone has to be told apart from the start of an arrow)
+enum KEY : int { KEY_NONE = 0, KEY_UP = 256, KEY_DOWN, KEY_LEFT, KEY_RIGHT, KEY_ENTER, KEY_BACKSPACE, KEY_ESCAPE };
+
+// next key press (KEY_NONE when nothing was typed), shared by the local controller and the attach client
+int readKey() {
+    if (!kbhit()) return KEY_NONE;
+    int code = _getch();
+
+    // Cross-platform Arrow Key Handling
+    // Windows: Starts with 0 or 224
+    // Linux: Starts with Escape (27), then '[', then A, B, C, or D
+    #ifdef _WIN32
+    if (code == 0 || code == 224) {
+        switch (_getch()) {
+            case 72: return KEY_UP;
+            case 80: return KEY_DOWN;
+            case 75: return KEY_LEFT;
+            case 77: return KEY_RIGHT;
+            default: return KEY_NONE;
         }
-        #else
-        if (code == 27) { // Escape sequence
-            _getch(); // Skip '['
-            int arrow = _getch();
-            switch (arrow) {
-                case 'A': return 'U'; // UP
-                case 'B': return 'D'; // DOWN
-                case 'D': 
-                    playbackInfo.playhead.store(0);
-                    playbackInfo.startTime.store(std::chrono::steady_clock::now());
-                    break;                
-                case 'C':
-                    playbackInfo.isPlaying = false; // Skip to next song 
-                    break;
-            }
+    }
+    if (code == 27) return KEY_ESCAPE;
+    #else
+    if (code == 27) { // Escape sequence
+        if (!kbhit()) return KEY_ESCAPE; // lone Escape, not the start of an arrow sequence
+        _getch(); // Skip '['
+        switch (_getch()) {
+            case 'A': return KEY_UP;
+            case 'B': return KEY_DOWN;
+            case 'D': return KEY_LEFT;
+            case 'C': return KEY_RIGHT;
+            default: return KEY_NONE;
         }
-        #endif
-
-        // Standard Actions
-        if (code == 'q' || code == 'Q') {
-            playbackInfo.isPlaying = false; 
-            ma_device_stop(pDevice); 
-            ma_device_uninit(pDevice);
-            echo::reset_cursor(); 
-            return 'q';
-        } 
-        
-        // Navigation Logic (Normalized arrow returns)
-        char action = (char)code;
-        // If we returned U, D, L, R from the arrow logic above, handle it here
-        // (Simplified for brevity, apply your playbackInfo logic here)
-        
-        if (code == 'p' || code == 'P' || code == ' ') {
-            bool paused = playbackInfo.pause.load();
-            if (!paused) {
-                playbackInfo.pausedAt = std::chrono::steady_clock::now();
-            } else {
-                auto now = std::chrono::steady_clock::now();
-                auto pause_duration = now - playbackInfo.pausedAt;
-                playbackInfo.startTime.store(playbackInfo.startTime.load() + 
-                    std::chrono::duration_cast<std::chrono::milliseconds>(pause_duration));
+    }
+    #endif
+    if (code == '\n' || code == '\r') return KEY_ENTER;
+    if (code == 127 || code == 8) return KEY_BACKSPACE;
+    return code;
+}
+
+// takes action based on keyboard input and return the key pressed (which is used for some controls in main)
+char controller(Playback& playbackInfo) { 
+    int key = readKey();
+
+    switch (key) {
+        case KEY_NONE:  return '\0';
+        case KEY_UP:    return 'U';
+        case KEY_DOWN:  return 'D';
+        case KEY_LEFT:  playbackInfo.restart(); return 'L';
+        case KEY_RIGHT: playbackInfo.skip(); return 'R';  // Skip to next song
+        case KEY_ENTER: return '\n';
+        case KEY_BACKSPACE: case KEY_ESCAPE: return '\0';
+
+        case 'q': case 'Q':
+            return 'q'; // main quits through the Player (device closed, then the screen is handed back)
+
+        case 'p': case 'P': case ' ':
+            playbackInfo.togglePause();
+            break;
+    }
+    return (char)key;
+}
+
+// state of the '/' search prompt, while it is open the visualizer window shows the results instead of bars
+struct SearchPrompt {
+    bool active = false;
+    std::string query;
+    std::vector<TrackInfo> results;
+    int selected = 0;
+    size_t indexedAt = 0;                   // index size the results were computed with (rerun while the scan grows it)
+};
+
+// keys while searching: text edits the query, Up/Down move the selection, Enter picks, Esc closes
+// returns the musicLibrary index of the picked track, -1 otherwise
+long searchInput(SearchPrompt& prompt, const LibraryIndex& index, size_t maxResults) {
+    bool changed = false;
+
+    switch (int key = readKey()) {
+        case KEY_NONE:   break;
+        case KEY_ESCAPE: prompt.active = false; return -1;
+        case KEY_UP:     prompt.selected = std::max(0, prompt.selected - 1); return -1;
+        case KEY_DOWN:   prompt.selected = std::min((int)prompt.results.size() - 1, prompt.selected + 1); return -1;
+
+        case KEY_ENTER:
+            if (prompt.results.empty()) return -1;
+            prompt.active = false;
+            return (long)prompt.results[prompt.selected].libraryIndex;
+
+        case KEY_BACKSPACE:
+            if (!prompt.query.empty()) prompt.query.pop_back();
+            changed = true;
+            break;
+
+        default:
+            if (key < KEY_UP && std::isprint(key)) {
+                prompt.query.push_back((char)key);
+                changed = true;
             }
-            playbackInfo.pause.store(!paused);
-        }
-        return code;
+            break;
+    }
+
+    if (changed || index.size() != prompt.indexedAt) { // new keystroke or the scanner found more tracks
+        prompt.indexedAt = index.size();
+        prompt.results = index.search(prompt.query, maxResults);
+        prompt.selected = 0;
+    }
+    return -1;
+}
+
+void drawSearch(echo::Window& window, Compositor::Queue& ui, const SearchPrompt& prompt) {
+    size_t width = std::max(window.get_w() - 4, 0);
+    auto fit = [width](std::string text) { return (text.length() > width) ? text.substr(0, width) : text; };
+
+    std::vector<std::string> lines;
+    lines.push_back(format(fit("Search: " + prompt.query + "_   (" + std::to_string(prompt.indexedAt) + " tracks indexed, Enter to queue it next, Esc to close)"), BOLD));
+    lines.push_back("");
+
+    for (size_t i = 0; i < prompt.results.size(); i++) {
+        const TrackInfo& track = prompt.results[i];
+        std::string line = fit(((int)i == prompt.selected ? "> " : "  ") + track.title + " - " + track.artist + " (" + track.album + ")");
+        lines.push_back((int)i == prompt.selected ? format(line, BOLD) : line);
     }
-    return '\0';
-}
\ No newline at end of file
+    if (prompt.results.empty() && !prompt.query.empty()) lines.push_back(format("  no matches", DIM_BOLD));
+
+    Compositor::submit(ui, [&window, lines = std::move(lines)]() {
+        window.clean_buffer();
+        for (size_t i = 0; i < lines.size() && (int)i < window.get_h(); i++) window.print((int)i, 2, lines[i]);
+        window.render(true);
+    });
+}
@@ -0,0 +1,213 @@
+# pragma once
+
+#include <vector>
+#include <thread>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include <simd.hpp>
+
+namespace fs = std::filesystem;
+
+// min/max/RMS mipmap over the mono samples (level 0 = BASE_BLOCK samples per entry, every next level halves it)
+// any range of the track can be summarised by reading a couple of entries per level instead of scanning samples
+class WaveformPyramid {
+public:
+    static constexpr size_t BASE_BLOCK = 1024;                              // ~23ms at 44.1kHz, fine enough for any terminal width
+
+    struct Envelope {
+        float min = 0.0f, max = 0.0f, rms = 0.0f;
+        size_t samples = 0;                                                 // covered by this entry, weights its rms in a merge
+    };
+
+    struct Level {
+        size_t blockSize;                                                   // samples covered by one entry
+        std::vector<Envelope> entries;
+    };
+
+private:
+    std::vector<Level> levels;
+    size_t totalSamples = 0;
+
+    static constexpr uint32_t MAGIC = 0x50574141;                           // "AAWP"
+    static constexpr uint32_t VERSION = 1;
+
+    // entries of different sizes meet in odd carries, query() walks and the short last block: power is averaged per sample
+    static Envelope merge(const Envelope& a, const Envelope& b) {
+        size_t samples = a.samples + b.samples;
+        float power = samples ? (a.rms * a.rms * a.samples + b.rms * b.rms * b.samples) / samples : 0.0f;
+        return { std::min(a.min, b.min), std::max(a.max, b.max), std::sqrt(power), samples };
+    }
+
+    size_t blockSamples(size_t block) const { return std::min(BASE_BLOCK, totalSamples - block * BASE_BLOCK); } // level 0, the last one is short
+
+    void buildUpperLevels() { // each level is the pairwise merge of the one below until a single entry is left
+        while (levels.back().entries.size() > 1) {
+            const Level& below = levels.back();
+            Level level{ below.blockSize * 2, {} };
+            level.entries.reserve((below.entries.size() + 1) / 2);
+
+            for (size_t i = 0; i < below.entries.size(); i += 2) {
+                if (i + 1 < below.entries.size()) level.entries.push_back(merge(below.entries[i], below.entries[i + 1]));
+                else level.entries.push_back(below.entries[i]);
+            }
+            levels.push_back(std::move(level));
+        }
+    }
+
+public:
+    bool empty() const { return levels.empty(); }
+    size_t samples() const { return totalSamples; }
+    const std::vector<Level>& getLevels() const { return levels; }
+
+    // level 0 is split across threads (independent blocks), the upper levels are tiny and built serially
+    void build(const std::vector<float>& monoSamples, unsigned threads = std::thread::hardware_concurrency()) {
+        levels.clear();
+        totalSamples = monoSamples.size();
+        if (totalSamples == 0) return;
+
+        size_t count = (totalSamples + BASE_BLOCK - 1) / BASE_BLOCK;
+        Level base{ BASE_BLOCK, std::vector<Envelope>(count) };
+
+        auto work = [&](size_t first, size_t last) {
+            for (size_t b = first; b < last; b++) {
+                size_t start = b * BASE_BLOCK;
+                size_t n = blockSamples(b);
+
+                float sumSq;
+                Envelope& e = base.entries[b];
+                simd::minMaxSumSq(monoSamples.data() + start, n, e.min, e.max, sumSq);
+                e.rms = std::sqrt(sumSq / n);
+                e.samples = n;
+            }
+        };
+
+        threads = std::max(1u, std::min<unsigned>(threads, (unsigned)(count / 64 + 1))); // don't spawn threads for a few blocks
+        size_t chunk = (count + threads - 1) / threads;
+
+        std::vector<std::thread> workers;
+        for (unsigned t = 1; t < threads; t++) {
+            size_t first = t * chunk;
+            if (first >= count) break;
+            workers.emplace_back(work, first, std::min(count, first + chunk));
+        }
+        work(0, std::min(count, chunk)); // calling thread takes the first chunk
+        for (std::thread& worker : workers) worker.join();
+
+        levels.push_back(std::move(base));
+        buildUpperLevels();
+    }
+
+    // envelope of samples [begin, end) at BASE_BLOCK precision, segment-tree walk: at most 2 entries per level
+    Envelope query(size_t begin, size_t end) const {
+        if (levels.empty() || begin >= totalSamples) return {};
+        end = std::clamp(end, begin + 1, totalSamples);
+
+        size_t lo = begin / BASE_BLOCK;                                     // [lo, hi) in entries of the current level
+        size_t hi = (end - 1) / BASE_BLOCK + 1;
+
+        Envelope result;
+        bool first = true;
+        auto take = [&](const Envelope& e) { result = first ? e : merge(result, e); first = false; };
+
+        for (size_t l = 0; l < levels.size() && lo < hi; l++, lo /= 2, hi /= 2) {
+            if (lo & 1) take(levels[l].entries[lo++]);                      // left edge is not covered by a parent
+            if (hi & 1) take(levels[l].entries[--hi]);                      // neither is the right edge
+        }
+        return result;
+    }
+
+    // the whole track squeezed into 'width' columns (one envelope per terminal cell)
+    std::vector<Envelope> overview(int width) const {
+        std::vector<Envelope> columns(std::max(width, 0));
+        if (levels.empty()) return columns;
+
+        for (int c = 0; c < width; c++) {
+            size_t begin = totalSamples * c / width;
+            size_t end = totalSamples * (c + 1) / width;
+            columns[c] = query(begin, end);
+        }
+        return columns;
+    }
+
+    float peak() const { // loudest sample of the whole track (top of the pyramid)
+        if (levels.empty()) return 0.0f;
+        const Envelope& top = levels.back().entries.front();
+        return std::max(std::fabs(top.min), std::fabs(top.max));
+    }
+
+    // only level 0 is stored (quantised to int16, ~6 bytes per 1024 samples), the rest is rebuilt on load
+    bool save(const fs::path& path, uint64_t key) const {
+        if (levels.empty()) return false;
+
+        const std::vector<Envelope>& base = levels.front().entries;
+        uint64_t samples = totalSamples, count = base.size();
+
+        std::vector<int16_t> packed;
+        packed.reserve(count * 3);
+        auto quantise = [](float v) { return (int16_t)std::lround(std::clamp(v, -1.0f, 1.0f) * 32767.0f); };
+
+        for (const Envelope& e : base) {
+            packed.push_back(quantise(e.min));
+            packed.push_back(quantise(e.max));
+            packed.push_back(quantise(e.rms));
+        }
+
+        fs::path partial = path.string() + ".part";                         // attached clients may be reading the old one right now
+        {
+            std::ofstream out(partial, std::ios::binary);
+            if (!out) return false;
+
+            out.write(reinterpret_cast<const char*>(&MAGIC), sizeof(MAGIC));
+            out.write(reinterpret_cast<const char*>(&VERSION), sizeof(VERSION));
+            out.write(reinterpret_cast<const char*>(&key), sizeof(key));
+            out.write(reinterpret_cast<const char*>(&samples), sizeof(samples));
+            out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+            out.write(reinterpret_cast<const char*>(packed.data()), packed.size() * sizeof(int16_t));
+            if (!out) return false;
+        }
+
+        std::error_code ec;
+        fs::rename(partial, path, ec);                                      // readers see the old file or the new one, never half of it
+        return !ec;
+    }
+
+    // false (and left empty) when the file is missing, corrupt or was written for another version of the track
+    bool load(const fs::path& path, uint64_t key, size_t expectedSamples) {
+        levels.clear();
+        totalSamples = 0;
+
+        std::ifstream in(path, std::ios::binary);
+        if (!in) return false;
+
+        uint32_t magic = 0, version = 0;
+        uint64_t storedKey = 0, samples = 0, count = 0;
+
+        in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+        in.read(reinterpret_cast<char*>(&version), sizeof(version));
+        in.read(reinterpret_cast<char*>(&storedKey), sizeof(storedKey));
+        in.read(reinterpret_cast<char*>(&samples), sizeof(samples));
+        in.read(reinterpret_cast<char*>(&count), sizeof(count));
+
+        if (!in || magic != MAGIC || version != VERSION || storedKey != key || samples != expectedSamples) return false;
+        if (samples == 0 || count != (samples + BASE_BLOCK - 1) / BASE_BLOCK) return false;
+
+        std::vector<int16_t> packed(count * 3);
+        in.read(reinterpret_cast<char*>(packed.data()), packed.size() * sizeof(int16_t));
+        if (!in) return false;
+
+        Level base{ BASE_BLOCK, std::vector<Envelope>(count) };
+        for (size_t i = 0; i < count; i++) {
+            base.entries[i] = { packed[i * 3] / 32767.0f, packed[i * 3 + 1] / 32767.0f, packed[i * 3 + 2] / 32767.0f, 0 };
+        }
+
+        totalSamples = samples;
+        for (size_t i = 0; i < count; i++) base.entries[i].samples = blockSamples(i); // not stored, follows from the length
+        levels.push_back(std::move(base));
+        buildUpperLevels();
+        return true;
+    }
+};
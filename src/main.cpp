@@ -14,6 +14,10 @@
 #include <image.hpp>
 #include <playback.hpp>
 #include <utils.hpp>
+#include <options.hpp>
+#include <player.hpp>
+#include <daemon.hpp>
+#include <client.hpp>
 
 #include <iostream>
 #include <thread>
@@ -25,9 +29,28 @@ namespace tv = echo;
 namespace Viz = echo::Visualizer::Plots;
 
 int main(int argc, char* argv[]) {
+    Options opts = parseOptions(argc, argv);
+
+#ifndef _WIN32
+    if (opts.daemon) return runDaemon(opts);                // engine only, UIs attach over the socket
+    if (opts.attach) return runClient(opts);                // UI only, a daemon plays
+#endif
+
     tv::clear_screen();
-    std::vector<fs::path> musicLibrary;
-    (argc == 2)? musicLibrary = getMP3Files(argv[1]) : musicLibrary = getMP3Files(); // storing all the paths of the music (we don't create music objects yet to save memory)
+    std::vector<fs::path> musicLibrary = getMP3Files(opts.musicDir); // storing all the paths of the music (we don't create music objects yet to save memory)
+
+    // tags are read in the background, the search prompt ('/') works on whatever is indexed so far
+    LibraryIndex libraryIndex;
+    LibraryScanner scanner(musicLibrary, libraryIndex);
+    std::unique_ptr<LoudnessScanner> loudnessScanner;       // measures the library while we play, results land in the cache
+    if (opts.normalize) loudnessScanner = std::make_unique<LoudnessScanner>(musicLibrary, opts.realtime);
+    SearchPrompt search;
+
+    // from here on only the compositor writes to the terminal, every thread submits through its own queue
+    Compositor compositor;
+    Compositor::Queue& ui = compositor.queue();             // main loop: cover, title, visualizer
+    Compositor::Queue& progressUi = compositor.queue();     // runTimestamp thread
+    compositor.start();
 
     tv::Window fft(IMAGE_W + 1, 1, FULL_WINDOW_WIDTH - IMAGE_W - 1, IMAGE_H, "Visualizer");
     tv::Window title(1, IMAGE_H + 1, FULL_WINDOW_WIDTH - 1, TITLE_H, "Now Playing");
@@ -35,7 +58,6 @@ int main(int argc, char* argv[]) {
 
     int barWidth = 7;
     int maxBars = Viz::getMaxBars(fft, barWidth);
-    int sample_window_size = 1024;
     // we'll consider the 70% width of the playback window
     // 15% space --------------70% playback------------ 15% space
 
@@ -47,70 +69,68 @@ int main(int argc, char* argv[]) {
     std::vector<echo::COLOR> barColors(maxBars, echo::COLOR(echo::COLOR::BLUE)); // all bars blue
 
     // objects needed
-    Playback playbackInfo;
-    ma_device_config config = ma_device_config_init(ma_device_type_playback);
-    config.playback.format   = ma_format_f32;   // since std::vector<float> for samples
-    config.playback.channels = 1;               // Mono (since every music was converted into mono)
-    config.dataCallback      = data_callback;   // The function we wrote in playback.hpp
-    config.pUserData         = &playbackInfo;   // the info it'll send to the data_callback function
-    
-    kiss_fft_cfg cfg = kiss_fft_alloc(sample_window_size, 0, nullptr, nullptr); 
+    std::unique_ptr<SpectrumAnalyzer> analyzer = makeAnalyzer(opts.fftSize); // FFT size picked on the command line
 
-    bool deviceInitialized = false;
-    ma_device device; // speaker
+    Player player(opts, (long)musicLibrary.size(), [&](long index, int deviceRate) { return loadTrack(musicLibrary[index], opts.realtime, deviceRate); });
+    Playback& playbackInfo = player.playback;
+    player.analyzer = analyzer.get();
 
-    // in loop we update rest of the config as necessary
+    std::thread playback_thread;
+    bool rtReported = true;
 
     // ------------------------ PLAYBACK LOOP ----------------------------
-    int music_index = 0;
-    bool prev;
-    while (true) {
-        Music music(musicLibrary[music_index]); // loading music
-        playbackInfo = music;                   // creating music reference for playback (reduce casting cost)
-        prev = false;
-
-        screenInit(music, title);               // display everything at the start of the music
-
-        // music related config
-        config.sampleRate = music.sample_rate; // NOTE: When changing this we need to reconfigure our ma_device (since it'll be locked to previous settings)
-
-        if (deviceInitialized) ma_device_uninit(&device);
-        if (ma_device_init(NULL, &config, &device) != MA_SUCCESS) continue; 
-        deviceInitialized = true;
-
-        // set the music's start time
-        playbackInfo.startTime.store(std::chrono::steady_clock::now());
-
-        // start music
-        ma_device_start(&device); // creates its own thread for music playback
-
-        std::thread playback_thread(runTimestamp, std::ref(playback), std::ref(music), std::ref(playbackInfo), playback_width, bar_width, starting_col);
-
-        while (playbackInfo.isPlaying) { // this is falsed in our data_callback function 
+    player.onTrack = [&](long, LoadedTrack& track) {
+        screenInit(*track.music, title, ui, opts.palette, opts.dither);      // display everything at the start of the music
+        playback_thread = std::thread(runTimestamp, std::ref(playback), std::ref(progressUi), std::cref(*track.music), std::cref(playbackInfo), std::cref(track.waveform), playback_width, bar_width, starting_col);
+        rtReported = !opts.realtime.enabled;
+    };
+
+    player.onTrackEnd = [&]() { playback_thread.join(); };
+
+    player.onFrame = [&]() {
+        if (search.active) { // keys belong to the prompt until it is closed
+            long picked = searchInput(search, libraryIndex, fft.get_h() - 2);
+            if (picked >= 0) player.queue(picked);
+        } else {
             // next music
-            char code = controller(playbackInfo, &device); 
+            char code = controller(playbackInfo); 
             switch(code) { // rest of the controls are handled inside the function 
-                case 'q': playback_thread.join(); return 0;
-                case 'b': prev = true; playbackInfo.isPlaying = false; break;
+                case 'q': player.quit(); return;
+                case 'b': player.back(); break;
+                case '/': search = SearchPrompt{}; search.active = true; break;
+                case ',': playbackInfo.movePreview(-1, bar_width); break;   // seek preview, drawn by runTimestamp
+                case '.': playbackInfo.movePreview(+1, bar_width); break;
+                case '\n': playbackInfo.seekToPreview(player.sampleRate()); break;
                 default: break;
             }
-            
-            if (!playbackInfo.pause.load()) {
-                // equalizer stuff
-                Viz::draw_bars(fft, getNbars(playbackInfo, cfg, maxBars, fft.get_h()), barWidth, barColors, '#');
+        }
+
+        if (!rtReported && playbackInfo.audioStatus.load() >= 0) { // audio thread has tried to promote itself by now
+            const LoadedTrack& track = player.track();
+            std::string report = realtimeReport(playbackInfo.audioStatus.load(), track.decodeStatus, track.lockStatus);
+            Compositor::submit(ui, [&title, report]() {
+                title.print(3, getPadding(report, title.get_w()), format(report, DIM_BOLD));
+                title.render(true);
+            });
+            rtReported = true;
+        }
+
+        if (search.active) {
+            drawSearch(fft, ui, search);
+        } else if (!playbackInfo.pause.load()) {
+            // equalizer stuff
+            Compositor::submit(ui, [&fft, &barColors, barWidth, bars = analyzer->bars(playbackInfo, maxBars, fft.get_h(), opts.spectrum, player.sampleRate())]() {
+                Viz::draw_bars(fft, bars, barWidth, barColors, '#');
                 fft.render();
-            }
-        
-            std::this_thread::sleep_for(25_FPS); 
-        }   
-
-        playback_thread.join();
-        ma_device_stop(&device);
-        music_index = prev ? music_index = (musicLibrary.size() + (music_index - 1)) % musicLibrary.size() : (music_index + 1) % musicLibrary.size();
-    }
+            });
+        }
+    
+        std::this_thread::sleep_for(25_FPS); 
+    };
 
-    free(cfg);
+    player.run();
 
+    compositor.stop();
     tv::reset_cursor();
     return 0;
 }
@@ -0,0 +1,342 @@
+// Headless soak / stress test of the playback engine: mixer + audio callback on miniaudio's null backend, the progress
+// thread and the compositor, driven through thousands of scripted next/back/pause/restart/quit sequences. Runs the same
+// Player loop as main and the daemon (preload, queued handover, back stepping the index) on synthetic tracks.
+// Fails on a hang (watchdog), on a wrong track order, on tracks or threads that outlive their session and on memory
+// growth, prints the latency distribution of every control.
+//
+//   AsciiAmpSoak [--sessions=N] [--steps=N] [--seed=N] [--timeout=SECONDS]
+//
+// Built with -DASCIIAMP_SOAK=ON (add -DASCIIAMP_TSAN=ON for ThreadSanitizer). Screen output goes to /dev/null, the
+// report to stderr.
+
+#define MINIMP3_IMPLEMENTATION
+#define MINIAUDIO_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <map>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+#include <echo.hpp>
+
+#include <music.hpp>
+#include <playback.hpp>
+#include <utils.hpp>
+#include <options.hpp>
+#include <player.hpp>
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+struct SoakOptions {
+    int sessions = 200;                     // device open -> tracks -> quit cycles
+    int steps = 25;                         // controls per session (the last one is always quit)
+    unsigned seed = 1;
+    int timeout = 5;                        // seconds without progress before we call it a deadlock
+};
+
+SoakOptions parseSoakOptions(int argc, char* argv[]) {
+    SoakOptions opts;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&](const std::string& flag) { return arg.substr(flag.length()); };
+
+        if (arg.rfind("--sessions=", 0) == 0)     opts.sessions = std::max(1, std::stoi(value("--sessions=")));
+        else if (arg.rfind("--steps=", 0) == 0)   opts.steps = std::max(1, std::stoi(value("--steps=")));
+        else if (arg.rfind("--seed=", 0) == 0)    opts.seed = (unsigned)std::stoul(value("--seed="));
+        else if (arg.rfind("--timeout=", 0) == 0) opts.timeout = std::max(1, std::stoi(value("--timeout=")));
+        else throw std::invalid_argument("Unknown option: " + arg);
+    }
+    return opts;
+}
+
+// ------------------------------------------------------------------ process stats (Linux only, -1 elsewhere)
+
+long procStatus(const char* field) { // "Threads:" / "VmRSS:" (kB) from /proc/self/status
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind(field, 0) == 0) return std::atol(line.c_str() + std::strlen(field));
+    }
+    return -1;
+}
+
+long threadCount() { return procStatus("Threads:"); }
+long residentKb()  { return procStatus("VmRSS:"); }
+
+// ------------------------------------------------------------------ watchdog
+
+// the harness thread beats after every step, no beat for 'timeout' seconds = something is stuck: report and abort
+// (abort rather than exit so a debugger / core dump / TSan still sees every thread where it hangs)
+class Watchdog {
+    std::atomic<int64_t> lastBeat;
+    std::atomic<const char*> step{"start"};
+    std::atomic<int> session{0};
+    std::atomic<bool> running{true};
+    std::chrono::seconds timeout;
+    unsigned seed;
+    std::thread worker;
+
+    static int64_t now() { return Clock::now().time_since_epoch().count(); }
+
+public:
+    Watchdog(std::chrono::seconds timeout, unsigned seed) : lastBeat(now()), timeout(timeout), seed(seed) {
+        worker = std::thread([this]() {
+            while (running.load()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                if (Clock::duration(now() - lastBeat.load()) < this->timeout) continue;
+
+                std::fprintf(stderr, "DEADLOCK: no progress for %llds in '%s' (session %d, --seed=%u)\n",
+                             (long long)this->timeout.count(), step.load(), session.load(), this->seed);
+                std::abort();
+            }
+        });
+    }
+
+    ~Watchdog() {
+        running = false;
+        worker.join();
+    }
+
+    void beat(const char* what, int sessionIndex) {
+        step.store(what);
+        session.store(sessionIndex);
+        lastBeat.store(now());
+    }
+};
+
+// ------------------------------------------------------------------ latency bookkeeping
+
+class Latencies {
+    std::map<std::string, std::vector<double>> samples;                      // control -> milliseconds
+
+public:
+    void add(const std::string& control, Clock::time_point start) {
+        samples[control].push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    }
+
+    void report() {
+        std::fprintf(stderr, "\n%-10s %8s %9s %9s %9s %9s   (ms)\n", "control", "count", "p50", "p90", "p99", "max");
+        for (auto& [control, ms] : samples) {
+            std::sort(ms.begin(), ms.end());
+            auto at = [&](double q) { return ms[std::min(ms.size() - 1, (size_t)(q * ms.size()))]; };
+            std::fprintf(stderr, "%-10s %8zu %9.2f %9.2f %9.2f %9.2f\n", control.c_str(), ms.size(), at(0.5), at(0.9), at(0.99), ms.back());
+        }
+    }
+};
+
+// ------------------------------------------------------------------ one session
+
+constexpr long LIBRARY_SIZE = 8;            // tracks per session, back/next wrap around it like in a real library
+
+// short mono tones, some shorter than the scripted pauses so tracks also run out on their own. One seed per library
+// index: 'back' gets the same track again, and nothing is shared with the preload worker that also calls this
+std::shared_ptr<LoadedTrack> syntheticTrack(unsigned seed, int sampleRate) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> seconds(0.2f, 2.0f), pitch(110.0f, 880.0f);
+    float length = seconds(rng), frequency = pitch(rng);
+
+    std::vector<float> samples((size_t)(length * sampleRate));
+    for (size_t i = 0; i < samples.size(); i++) samples[i] = 0.5f * std::sin(6.2831853f * frequency * i / sampleRate);
+
+    auto track = std::make_shared<LoadedTrack>();
+    track->music = std::make_unique<Music>(sampleRate, "Soak", "Harness", "Synthetic", "0:0" + std::to_string((int)length), std::vector<uint8_t>{}, std::move(samples));
+    track->music->channels = 1;
+    track->music->bitrate = "0";
+    track->waveform.build(track->music->monoSamples, 1);                    // what loadTrack does after decoding
+    return track;
+}
+
+// waits until the audio thread finished two more periods, i.e. one whole callback ran after the change
+bool audioCaughtUp(const Playback& playbackInfo, uint64_t periods) {
+    auto deadline = Clock::now() + std::chrono::seconds(1);
+    while (playbackInfo.periods.load() < periods + 2) {
+        if (Clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    return true;
+}
+
+enum Control { NEXT, BACK, PAUSE, RESTART, WAIT, QUIT };
+
+// one device lifetime through the Player main and the daemon run, the script plays the keyboard from onFrame; returns
+// an error description, empty when everything held
+std::string runSession(ma_context& context, int index, const SoakOptions& opts, std::mt19937& rng, Watchdog& watchdog, Latencies& latencies) {
+    std::discrete_distribution<int> pick({ 25, 15, 20, 20, 20 });         // NEXT .. WAIT, QUIT only ends the script
+    std::uniform_int_distribution<int> dwellMs(0, 20);
+    const float fades[] = { 0.0f, 0.05f, 0.3f };
+    const unsigned librarySeed = (unsigned)rng();
+
+    std::mutex tracksLock;                                                  // the loader also runs on the preload worker
+    std::vector<std::weak_ptr<LoadedTrack>> tracks;                         // everything loaded, must be gone after the session
+    auto alive = [&]() {
+        std::lock_guard<std::mutex> lock(tracksLock);
+        return (int)std::count_if(tracks.begin(), tracks.end(), [](auto& t) { return !t.expired(); });
+    };
+
+    std::string error;
+    {
+        echo::Window playback(1, IMAGE_H + TITLE_H + 1, FULL_WINDOW_WIDTH - 1, PLAYBACK_H, "Playback");
+
+        Compositor compositor;                                              // declared after the window it draws into
+        Compositor::Queue& progressUi = compositor.queue();
+        compositor.start();
+
+        Options playerOpts;
+        playerOpts.crossfade = fades[rng() % 3];
+        playerOpts.normalize = false;                                       // no cache to read loudness from
+
+        Player player(playerOpts, LIBRARY_SIZE, [&](long track, int deviceRate) {
+            std::shared_ptr<LoadedTrack> loaded = syntheticTrack(librarySeed + (unsigned)track, deviceRate ? deviceRate : 44100);
+            std::lock_guard<std::mutex> lock(tracksLock);
+            tracks.push_back(loaded);
+            return loaded;
+        }, &context);
+        Playback& playbackInfo = player.playback;
+
+        std::thread progress;
+        const char* pending = nullptr;                                      // next/back waiting for the new track's first audio
+        long expected = 0;                                                  // library index the next track change must land on
+        Clock::time_point issued, until;
+        int step = 0;
+        bool quit = false;
+
+        player.onTrack = [&](long track, LoadedTrack& loaded) {
+            if (track != expected && error.empty()) error = "expected library track " + std::to_string(expected) + ", got " + std::to_string(track);
+            expected = (track + 1) % LIBRARY_SIZE;                          // played on or skipped
+
+            if (pending) { // until the new track is being mixed, load (or preload hand over) included
+                if (!audioCaughtUp(playbackInfo, playbackInfo.periods.load())) error = std::string(pending) + ": audio thread stopped running";
+                latencies.add(pending, issued);
+                pending = nullptr;
+            }
+
+            // more tracks alive than mixer slots + the preloaded one = tracks aren't released once they faded out
+            if (alive() > Mixer::MAX_SOURCES + 1) error = "tracks kept alive after fading out: " + std::to_string(alive());
+
+            progress = std::thread(runTimestamp, std::ref(playback), std::ref(progressUi), std::cref(*loaded.music), std::cref(playbackInfo), std::cref(loaded.waveform), 100, 80, 10);
+        };
+
+        player.onTrackEnd = [&]() {
+            watchdog.beat("join progress thread", index);
+            progress.join();
+        };
+
+        player.onFrame = [&]() {
+            watchdog.beat("playing", index);
+            if (!error.empty()) { player.quit(); return; }
+            if (Clock::now() < until) { // dwell, the Player handles natural track ends and releases faded out tracks meanwhile
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                return;
+            }
+
+            Control control = (++step >= opts.steps) ? QUIT : (Control)pick(rng);
+            issued = Clock::now();
+            uint64_t periods = playbackInfo.periods.load();
+
+            switch (control) {
+                case NEXT:    player.next(); pending = "next"; break;
+                case BACK:    player.back(); pending = "back"; expected = (player.trackIndex() + LIBRARY_SIZE - 1) % LIBRARY_SIZE; break;
+                case RESTART: playbackInfo.restart(); break;
+                case QUIT:    watchdog.beat("quit", index); player.quit(); quit = true; break;
+                case PAUSE:   playbackInfo.togglePause(); break;
+                case WAIT:    break;
+            }
+
+            if (control == PAUSE || control == RESTART) { // until a whole callback ran with the change
+                const char* name = (control == RESTART) ? "restart" : (playbackInfo.pause.load() ? "pause" : "resume");
+                watchdog.beat(name, index);
+                if (!audioCaughtUp(playbackInfo, periods)) error = std::string(name) + ": audio thread stopped running";
+                latencies.add(name, issued);
+            }
+            until = Clock::now() + std::chrono::milliseconds(dwellMs(rng));
+        };
+
+        watchdog.beat("first track", index);
+        try {
+            player.run();
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+        if (quit && error.empty()) latencies.add("quit", issued);           // device closed + progress thread gone
+
+        if (progress.joinable()) { // run() threw between onTrack and onTrackEnd
+            playbackInfo.skip();
+            progress.join();
+        }
+        watchdog.beat("compositor stop", index);
+        compositor.stop();
+    }
+
+    if (error.empty() && alive() != 0) error = std::to_string(alive()) + " track(s) outlived the session";
+    return error;
+}
+
+int main(int argc, char* argv[]) {
+    SoakOptions opts = parseSoakOptions(argc, argv);
+
+#ifndef _WIN32
+    int devNull = open("/dev/null", O_WRONLY); // the compositor writes frames straight to fd 1
+    if (devNull >= 0) { dup2(devNull, STDOUT_FILENO); close(devNull); }
+#endif
+
+    ma_backend backends[] = { ma_backend_null };
+    ma_context context;
+    if (ma_context_init(backends, 1, NULL, &context) != MA_SUCCESS) {
+        std::fprintf(stderr, "could not initialise miniaudio's null backend\n");
+        return 1;
+    }
+
+    std::mt19937 rng(opts.seed);
+    Watchdog watchdog(std::chrono::seconds(opts.timeout), opts.seed);
+    Latencies latencies;
+
+    long baseThreads = -1, baseRss = -1;
+    int failures = 0;
+
+    for (int s = 0; s < opts.sessions; s++) {
+        std::string error = runSession(context, s, opts, rng, watchdog, latencies);
+        watchdog.beat("between sessions", s);
+
+        // the first session warms up allocators, lazily created threads (TSan's own, ...), its numbers become the baseline
+        if (s == 0) { baseThreads = threadCount(); baseRss = residentKb(); }
+
+        long threads = threadCount();
+        if (error.empty() && threads > baseThreads) error = "thread count grew from " + std::to_string(baseThreads) + " to " + std::to_string(threads);
+
+        if (!error.empty()) {
+            std::fprintf(stderr, "session %d (--seed=%u): %s\n", s, opts.seed, error.c_str());
+            if (++failures >= 10) break;
+        }
+    }
+
+    long rss = residentKb();
+    long growthKb = (baseRss >= 0 && rss >= 0) ? rss - baseRss : 0;
+    std::fprintf(stderr, "%d sessions x %d steps, seed %u: %d failure(s), threads %ld -> %ld, RSS %+ld kB\n",
+                 opts.sessions, opts.steps, opts.seed, failures, baseThreads, threadCount(), growthKb);
+    if (growthKb > 16 * 1024) { // tracks are freed per session, a steady climb means something isn't
+        std::fprintf(stderr, "memory grew by %ld kB over the run\n", growthKb);
+        failures++;
+    }
+
+    latencies.report();
+    ma_context_uninit(&context);
+    return failures == 0 ? 0 : 1;
+}